@@ -0,0 +1,64 @@
+#include "aggregation.h"
+
+// Send a full snapshot instead of a delta every N publish rounds
+const int FULL_EXPORT_EVERY = 10;
+
+static uint32_t nodeId = 0;
+static unsigned long lastExport = 0;
+static int exportRound = 0;
+
+void aggregation_init() {
+    // Lower 32 bits of the factory MAC are unique enough within one site
+    nodeId = (uint32_t)ESP.getEfuseMac();
+    lastExport = 0;
+    exportRound = 0;
+    Serial.printf("Aggregation node id: %08lX\n", (unsigned long)nodeId);
+}
+
+uint32_t aggregation_getNodeId() {
+    return nodeId;
+}
+
+bool aggregation_toRecord(const TrackedDevice& dev, DeviceRecord& out) {
+    // Stable identity: the first address seen, so a rotated BLE address
+    // is still the same record at the collector
+    if (dev.key == 0) {
+        return false;
+    }
+    out.mac = dev.key;
+    out.lastSeen = dev.lastSeen;
+    out.firstSeen = dev.firstSeen;
+    out.seenCount = dev.seenCount;
+    out.rssi = (int8_t)dev.rssi;
+    out.type = (uint8_t)dev.type;
+    out.channel = dev.channel;
+    strncpy(out.name, dev.name.c_str(), RECORD_NAME_LEN);
+    out.name[RECORD_NAME_LEN] = '\0';
+    return true;
+}
+
+int aggregation_publish(Print& out) {
+    unsigned long now = millis();
+    bool full = (exportRound++ % FULL_EXPORT_EVERY) == 0;
+    char line[128];
+    int written = 0;
+
+    const std::vector<TrackedDevice>& devices = tracking_view();
+
+    for (const auto& dev : devices) {
+        // Records merge idempotently, so re-sending a boundary device is harmless
+        if (!full && dev.lastSeen < lastExport) continue;
+
+        DeviceRecord rec;
+        if (!aggregation_toRecord(dev, rec)) continue;
+
+        int len = record_format(line, sizeof(line), nodeId, rec, now);
+        if (len > 0) {
+            out.write((const uint8_t*)line, len);
+            written++;
+        }
+    }
+
+    lastExport = now;
+    return written;
+}
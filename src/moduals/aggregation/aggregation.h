@@ -0,0 +1,21 @@
+#pragma once
+#include <Arduino.h>
+#include "device_record.h"
+#include "../tracking/tracking.h"
+
+// Export the local tracker state as mergeable records so several sensor
+// nodes can be combined into one site-wide table by tools/collector.
+
+// Initialize the exporter (derives the node id from the chip MAC)
+void aggregation_init();
+
+// Convert a tracked device to its wire record
+bool aggregation_toRecord(const TrackedDevice& dev, DeviceRecord& out);
+
+// Write records for devices changed since the last call, with a full
+// snapshot every few rounds so a collector that joins late catches up.
+// Returns the number of records written.
+int aggregation_publish(Print& out);
+
+// Node id used in exported records
+uint32_t aggregation_getNodeId();
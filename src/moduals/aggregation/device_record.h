@@ -0,0 +1,105 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../utils/mac_key.h"
+
+// Compact, mergeable per-device record exchanged between sensor nodes and
+// the host-side collector (tools/collector). Kept free of Arduino types so
+// both sides compile the exact same merge and wire-format code.
+
+#define RECORD_TAG "@DR"
+#define RECORD_NAME_LEN 32
+
+struct DeviceRecord {
+    uint64_t mac;        // 48-bit MAC, first octet in the high byte
+    uint32_t lastSeen;   // ms, on the clock of whoever holds the record
+    uint32_t firstSeen;
+    uint32_t seenCount;
+    int8_t rssi;
+    uint8_t type;        // DeviceType
+    uint8_t channel;
+    char name[RECORD_NAME_LEN + 1];
+};
+
+// Fold `in` into `into` (same MAC). Last writer wins on lastSeen for the
+// observed fields, seenCount takes the max and firstSeen the min, so merging
+// is idempotent and order-independent.
+inline void record_merge(DeviceRecord& into, const DeviceRecord& in) {
+    if (in.lastSeen > into.lastSeen) {
+        into.lastSeen = in.lastSeen;
+        into.rssi = in.rssi;
+        into.type = in.type;
+        into.channel = in.channel;
+        if (in.name[0] != '\0') {
+            memcpy(into.name, in.name, sizeof(into.name));
+        }
+    }
+    if (in.seenCount > into.seenCount) into.seenCount = in.seenCount;
+    if (in.firstSeen < into.firstSeen) into.firstSeen = in.firstSeen;
+}
+
+// Wire format, one record per line:
+//   @DR,<node>,<mac>,<type>,<channel>,<lastAge>,<firstAge>,<seenCount>,<rssi>,<name>
+// Times travel as ages (ms before the line was written) so the receiver can
+// rebase them onto its own clock without the nodes sharing a time source.
+// The name is the last field and may itself contain commas.
+inline int record_format(char* buf, size_t len, uint32_t node,
+                         const DeviceRecord& r, uint32_t now) {
+    char mac[18];
+    mac_format(r.mac, mac);
+
+    int n = snprintf(buf, len, RECORD_TAG ",%08lX,%s,%u,%u,%lu,%lu,%lu,%d,",
+                     (unsigned long)node, mac, r.type, r.channel,
+                     (unsigned long)(now - r.lastSeen),
+                     (unsigned long)(now - r.firstSeen),
+                     (unsigned long)r.seenCount, r.rssi);
+    if (n < 0 || (size_t)n >= len) return 0;
+
+    // Control characters would break the line framing
+    for (const char* p = r.name; *p && (size_t)n + 2 < len; p++) {
+        buf[n++] = ((unsigned char)*p < ' ') ? '?' : *p;
+    }
+    buf[n++] = '\n';
+    buf[n] = '\0';
+    return n;
+}
+
+// Parse one line (without the trailing newline). Ages are rebased onto `now`.
+inline bool record_parse(const char* line, uint32_t now, uint32_t* node, DeviceRecord* out) {
+    size_t tagLen = strlen(RECORD_TAG);
+    if (strncmp(line, RECORD_TAG ",", tagLen + 1) != 0) return false;
+
+    const char* p = line + tagLen + 1;
+    char* end;
+    unsigned long fields[6];
+
+    *node = strtoul(p, &end, 16);
+    if (*end != ',') return false;
+    if (!mac_parse(end + 1, &out->mac)) return false;
+    p = end + 1 + 17;
+    if (*p != ',') return false;
+    p++;
+
+    for (int i = 0; i < 6; i++) {
+        long v = strtol(p, &end, 10);
+        if (end == p || *end != ',') return false;
+        fields[i] = (unsigned long)v;
+        p = end + 1;
+    }
+
+    out->type = (uint8_t)fields[0];
+    out->channel = (uint8_t)fields[1];
+    out->lastSeen = fields[2] > now ? 0 : now - fields[2];
+    out->firstSeen = fields[3] > now ? 0 : now - fields[3];
+    out->seenCount = fields[4];
+    out->rssi = (int8_t)(long)fields[5];
+
+    size_t nameLen = strcspn(p, "\r\n");
+    if (nameLen > RECORD_NAME_LEN) nameLen = RECORD_NAME_LEN;
+    memcpy(out->name, p, nameLen);
+    out->name[nameLen] = '\0';
+    return true;
+}
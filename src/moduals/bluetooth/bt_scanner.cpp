@@ -2,10 +2,84 @@
 #include <BLEDevice.h>
 #include <BLEScan.h>
 #include <BLEAdvertisedDevice.h>
-#include "../utils/distance.h"
+#include "../utils/rssi_kernels.h"
+#include "../utils/mac_key.h"
 
 BLEScan* scanner;
 BLEClient* bleClient = nullptr;
+static SemaphoreHandle_t radioMutex = nullptr;
+
+// Bluetooth SIG company identifier from the manufacturer data, 0 if absent
+uint16_t getCompanyId(BLEAdvertisedDevice& device) {
+    if (!device.haveManufacturerData()) return 0;
+    
+    std::string mfgData = device.getManufacturerData();
+    if (mfgData.length() < 2) return 0;
+    
+    // Little-endian, first two bytes of the payload
+    return ((uint8_t)mfgData[1] << 8) | (uint8_t)mfgData[0];
+}
+
+// Hash of the advertisement fields that survive address rotation: company
+// ID and manufacturer payload layout, service UUID set, TX power and
+// appearance. Returns 0 when the advertisement carries none of them.
+uint32_t getFingerprint(BLEAdvertisedDevice& device) {
+    uint32_t hash = 2166136261u;
+    bool any = false;
+    
+    auto mix = [&](uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 16777619u;
+        }
+        any = true;
+    };
+    
+    if (device.haveManufacturerData()) {
+        std::string mfgData = device.getManufacturerData();
+        mix(0x01000000 | getCompanyId(device));
+        mix(mfgData.length());
+        
+        // Type and length bytes after the company ID describe the layout
+        // (e.g. Apple Continuity message type); the rest changes too often
+        if (mfgData.length() >= 4) {
+            mix(0x02000000 | ((uint8_t)mfgData[2] << 8) | (uint8_t)mfgData[3]);
+        }
+    }
+    
+    if (device.haveServiceUUID()) {
+        // Order-independent combination of the advertised UUID set
+        uint32_t uuidSet = 0;
+        int count = device.getServiceUUIDCount();
+        for (int i = 0; i < count; i++) {
+            std::string uuid = device.getServiceUUID(i).toString();
+            uint32_t h = 2166136261u;
+            for (char c : uuid) h = (h ^ (uint8_t)c) * 16777619u;
+            uuidSet += h;
+        }
+        mix(0x03000000 | count);
+        mix(uuidSet);
+    }
+    
+    if (device.haveTXPower()) {
+        mix(0x04000000 | (uint8_t)device.getTXPower());
+    }
+    
+    if (device.haveAppearance()) {
+        mix(0x05000000 | device.getAppearance());
+    }
+    
+    if (!any) return 0;
+    return hash == 0 ? 1 : hash;
+}
+
+// Resolvable or non-resolvable private address (not random static), i.e.
+// one the device is expected to replace every few minutes
+bool isRotatingAddress(BLEAdvertisedDevice& device, uint64_t key) {
+    if (device.getAddressType() != BLE_ADDR_TYPE_RANDOM) return false;
+    
+    // Top two bits of the most significant octet: 11 = static random
+    return ((key >> 46) & 0x3) != 0x3;
+}
 
 // Device class identification based on appearance or services
 String identifyDeviceType(BLEAdvertisedDevice device) {
@@ -38,22 +112,9 @@ String identifyDeviceType(BLEAdvertisedDevice device) {
     }
     
     // Check manufacturer data for known vendors
-    if (device.haveManufacturerData()) {
-        std::string mfgData = device.getManufacturerData();
-        if (mfgData.length() >= 2) {
-            uint16_t companyId = (mfgData[1] << 8) | mfgData[0];
-            
-            switch(companyId) {
-                case 0x004C: return "Apple Device";
-                case 0x0075: return "Samsung Device";
-                case 0x00E0: return "Google Device";
-                case 0x0006: return "Microsoft Device";
-                case 0x0087: return "Garmin Device";
-                case 0x0157: return "Bose Device";
-                case 0x00A8: return "Sony Device";
-                default: break;
-            }
-        }
+    Vendor vendor = vendorFromCompanyId(getCompanyId(device));
+    if (vendor != VENDOR_UNKNOWN) {
+        return String(vendorName(vendor)) + " Device";
     }
     
     return "Unknown BLE";
@@ -75,14 +136,35 @@ void bt_init() {
     scanner->setActiveScan(true);
     scanner->setInterval(100);
     scanner->setWindow(99);
+    radioMutex = xSemaphoreCreateMutex();
     
     Serial.println("Bluetooth initialized");
 }
 
-std::vector<Device> bt_scan() {
+bool bt_lockRadio(uint32_t timeoutMs) {
+    return xSemaphoreTake(radioMutex, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+void bt_unlockRadio() {
+    xSemaphoreGive(radioMutex);
+}
+
+void bt_setDutyCycle(uint16_t intervalMs, uint16_t windowMs) {
+    scanner->setInterval(intervalMs);
+    scanner->setWindow(windowMs);
+}
+
+std::vector<Device> bt_scan(uint32_t seconds) {
     std::vector<Device> list;
 
-    BLEScanResults results = scanner->start(3, false);
+    // A GATT connection is being set up: skip this pass rather than stall
+    // the scan loop; the connect is bounded, so the next round gets the radio
+    if (!bt_lockRadio(0)) {
+        Serial.println("[BT] Radio busy with a connection, BLE pass skipped");
+        return list;
+    }
+    BLEScanResults results = scanner->start(seconds, false);
+    bt_unlockRadio();
 
     for (int i = 0; i < results.getCount(); i++) {
         BLEAdvertisedDevice dev = results.getDevice(i);
@@ -91,9 +173,13 @@ std::vector<Device> bt_scan() {
         d.mac = dev.getAddress().toString().c_str();
         d.name = dev.haveName() ? dev.getName().c_str() : identifyDeviceType(dev);
         d.rssi = dev.getRSSI();
-        d.distance = estimateDistance(d.rssi);
+        d.distance = rssi_distance(d.rssi);
         d.type = TYPE_BLUETOOTH;
         d.channel = 0; // BLE uses adaptive frequency hopping
+        d.vendor = vendorFromCompanyId(getCompanyId(dev));
+        d.fingerprint = getFingerprint(dev);
+        d.rotatingAddress = isRotatingAddress(dev, mac_toKey(d.mac.c_str()));
+        d.addrType = dev.getAddressType();
         
         list.push_back(d);
         
@@ -4,7 +4,15 @@
 #include "../wifi/wifi_scanner.h"
 
 void bt_init();
-std::vector<Device> bt_scan();
+// Scan for `seconds`, listening windowMs out of every intervalMs
+std::vector<Device> bt_scan(uint32_t seconds = 3);
+void bt_setDutyCycle(uint16_t intervalMs, uint16_t windowMs);
+
+// Serializes scanning with connection setup; a connection cannot be
+// initiated while a scan is running. Held by bt_scan() for its duration;
+// bt_scan() returns no devices if a connection attempt holds it.
+bool bt_lockRadio(uint32_t timeoutMs);
+void bt_unlockRadio();
 
 // Connection functions
 bool bt_connect(const String& address);
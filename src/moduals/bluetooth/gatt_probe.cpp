@@ -0,0 +1,323 @@
+#include "gatt_probe.h"
+#include <BLEDevice.h>
+#include <esp_gap_ble_api.h>
+#include <freertos/timers.h>
+#include "bt_scanner.h"
+#include "../tracking/tracking.h"
+#include "../events/events.h"
+#include "../utils/mac_key.h"
+
+static_assert(MAX_INTERNED_NAMES >= MAX_TRACKED_DEVICES + 2 * GATT_CACHE_SIZE,
+              "Name pool must hold a name per device plus the GATT strings");
+
+// Requests waiting for a worker
+const int GATT_QUEUE_LENGTH = 8;
+
+struct GattRequest {
+    uint64_t key;           // Cache key
+    uint64_t addrKey;       // Address to connect to
+    uint32_t fingerprint;
+    uint8_t addrType;
+};
+
+static QueueHandle_t requestQueue = nullptr;
+static SemaphoreHandle_t cacheMutex = nullptr;
+static int gattEvents = -1;
+
+// Shared between the workers and loop(); guarded by cacheMutex
+static GattInfo cache[GATT_CACHE_SIZE];
+static bool attached[GATT_CACHE_SIZE];   // Result already copied to the tracker
+static uint32_t cacheHits = 0;
+static uint32_t interrogations = 0;
+static uint32_t failures = 0;
+static uint32_t queueFull = 0;
+
+static bool expired(const GattInfo& info, unsigned long now) {
+    if (info.status == GATT_PENDING) return false;
+    unsigned long ttl = info.status == GATT_DONE ? GATT_CACHE_TTL : GATT_FAIL_TTL;
+    return now - info.fetchedAt > ttl;
+}
+
+// Cache slot for a MAC, or for the fingerprint of a rotated address.
+// Caller holds cacheMutex.
+static int findEntry(uint64_t key, uint32_t fingerprint) {
+    int byFingerprint = -1;
+    for (int i = 0; i < GATT_CACHE_SIZE; i++) {
+        if (cache[i].key == 0) continue;
+        if (cache[i].key == key) return i;
+        if (fingerprint != 0 && cache[i].fingerprint == fingerprint) byFingerprint = i;
+    }
+    return byFingerprint;
+}
+
+// Free or expired slot, else the oldest one. Caller holds cacheMutex.
+static int allocEntry(unsigned long now) {
+    int oldest = -1;
+    for (int i = 0; i < GATT_CACHE_SIZE; i++) {
+        if (cache[i].key == 0 || expired(cache[i], now)) return i;
+        if (cache[i].status == GATT_PENDING) continue;
+        if (oldest < 0 || cache[i].fetchedAt < cache[oldest].fetchedAt) oldest = i;
+    }
+    return oldest;
+}
+
+static void readText(BLERemoteService* service, uint16_t uuid, char* out,
+                     unsigned long deadline) {
+    if ((long)(millis() - deadline) >= 0) return;
+
+    BLERemoteCharacteristic* ch = service->getCharacteristic(BLEUUID(uuid));
+    if (ch && ch->canRead()) {
+        std::string value = ch->readValue();
+        strncpy(out, value.c_str(), GATT_TEXT_LEN);
+        out[GATT_TEXT_LEN] = '\0';
+    }
+}
+
+// Cancels a connection attempt that outlives GATT_CONNECT_TIMEOUT. Core
+// 3.x takes the timeout in BLEClient::connect(); on 2.x connect() waits for
+// the stack's own timeout (~30 s) while holding the radio, so a one-shot
+// timer drops the pending link instead and connect() returns false.
+struct ConnectGuard {
+    TimerHandle_t timer;
+    esp_bd_addr_t address;
+    volatile bool fired;
+};
+
+static void connectTimeout(TimerHandle_t timer) {
+    ConnectGuard* guard = (ConnectGuard*)pvTimerGetTimerID(timer);
+    guard->fired = true;
+    esp_ble_gap_disconnect(guard->address);
+}
+
+static bool connectBounded(BLEClient* client, ConnectGuard& guard, BLEAddress& address,
+                           uint8_t addrType) {
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+    return client->connect(address, (esp_ble_addr_type_t)addrType, GATT_CONNECT_TIMEOUT);
+#else
+    if (guard.timer == nullptr) return false;   // Unbounded: do not try
+
+    memcpy(guard.address, *address.getNative(), sizeof(esp_bd_addr_t));
+    guard.fired = false;
+    xTimerStart(guard.timer, portMAX_DELAY);
+    bool connected = client->connect(address, (esp_ble_addr_type_t)addrType);
+    xTimerStop(guard.timer, portMAX_DELAY);
+
+    // The timer won a race with a link that just came up
+    if (connected && guard.fired) {
+        client->disconnect();
+        connected = false;
+    }
+    return connected;
+#endif
+}
+
+// Connect, read Device Information and Battery, disconnect
+static bool interrogate(BLEClient* client, ConnectGuard& guard, const GattRequest& req,
+                        GattInfo& info) {
+    unsigned long deadline = millis() + GATT_JOB_TIMEOUT;
+
+    char mac[18];
+    mac_format(req.addrKey, mac);
+    BLEAddress address{std::string(mac)};
+
+    // A connection cannot be set up while bt_scan() is running; bt_scan()
+    // skips its pass rather than wait for us, so the connect must be bounded
+    if (!bt_lockRadio(GATT_JOB_TIMEOUT)) return false;
+    bool connected = connectBounded(client, guard, address, req.addrType);
+    bt_unlockRadio();
+
+    if (!connected) return false;
+
+    BLERemoteService* infoService = client->getService(BLEUUID((uint16_t)0x180A));
+    if (infoService != nullptr) {
+        readText(infoService, 0x2A29, info.manufacturer, deadline);
+        readText(infoService, 0x2A24, info.model, deadline);
+    }
+
+    if ((long)(millis() - deadline) < 0) {
+        BLERemoteService* batteryService = client->getService(BLEUUID((uint16_t)0x180F));
+        if (batteryService != nullptr) {
+            BLERemoteCharacteristic* ch = batteryService->getCharacteristic(BLEUUID((uint16_t)0x2A19));
+            if (ch && ch->canRead()) {
+                info.battery = ch->readUInt8();
+            }
+        }
+    }
+
+    client->disconnect();
+    return true;
+}
+
+static void workerTask(void*) {
+    BLEClient* client = BLEDevice::createClient();
+    GattRequest req;
+
+    ConnectGuard guard;
+    guard.fired = false;
+    guard.timer = xTimerCreate("gattconn", pdMS_TO_TICKS(GATT_CONNECT_TIMEOUT), pdFALSE,
+                               &guard, connectTimeout);
+
+    for (;;) {
+        if (xQueueReceive(requestQueue, &req, portMAX_DELAY) != pdTRUE) continue;
+
+        GattInfo info;
+        memset(&info, 0, sizeof(info));
+        info.key = req.key;
+        info.fingerprint = req.fingerprint;
+        info.battery = -1;
+
+        bool ok = interrogate(client, guard, req, info);
+        info.status = ok ? GATT_DONE : GATT_FAILED;
+        info.fetchedAt = millis();
+
+        xSemaphoreTake(cacheMutex, portMAX_DELAY);
+        int slot = findEntry(req.key, 0);
+        if (slot >= 0) {
+            cache[slot] = info;
+            attached[slot] = false;
+        }
+        interrogations++;
+        if (!ok) failures++;
+        xSemaphoreGive(cacheMutex);
+    }
+}
+
+void gatt_init() {
+    // Without discoveries there is nothing to probe; start nothing
+    gattEvents = events_subscribe("gatt");
+    if (gattEvents < 0) {
+        Serial.println("GATT probe: no event feed, probing disabled");
+        return;
+    }
+
+    requestQueue = xQueueCreate(GATT_QUEUE_LENGTH, sizeof(GattRequest));
+    cacheMutex = xSemaphoreCreateMutex();
+    memset(cache, 0, sizeof(cache));
+
+    for (int i = 0; i < GATT_MAX_CONCURRENT; i++) {
+        xTaskCreatePinnedToCore(workerTask, "gatt", 4096, nullptr, 1, nullptr, 0);
+    }
+
+    Serial.printf("GATT probe initialized (%d workers)\n", GATT_MAX_CONCURRENT);
+}
+
+bool gatt_request(uint64_t key, uint64_t addrKey, uint32_t fingerprint, uint8_t addrType) {
+    if (requestQueue == nullptr) return false;
+    unsigned long now = millis();
+
+    xSemaphoreTake(cacheMutex, portMAX_DELAY);
+    int slot = findEntry(key, fingerprint);
+    if (slot >= 0 && !expired(cache[slot], now)) {
+        cacheHits++;
+        xSemaphoreGive(cacheMutex);
+        return false;
+    }
+
+    // Reserve the slot as pending so repeat sightings are not queued twice
+    if (slot < 0) slot = allocEntry(now);
+    if (slot < 0) {
+        xSemaphoreGive(cacheMutex);
+        return false;
+    }
+
+    GattRequest req = { key, addrKey, fingerprint, addrType };
+    if (xQueueSend(requestQueue, &req, 0) != pdTRUE) {
+        queueFull++;
+        xSemaphoreGive(cacheMutex);
+        return false;
+    }
+
+    memset(&cache[slot], 0, sizeof(GattInfo));
+    cache[slot].key = key;
+    cache[slot].fingerprint = fingerprint;
+    cache[slot].status = GATT_PENDING;
+    cache[slot].battery = -1;
+    cache[slot].fetchedAt = now;
+    attached[slot] = true;
+    xSemaphoreGive(cacheMutex);
+    return true;
+}
+
+bool gatt_lookup(uint64_t key, uint32_t fingerprint, GattInfo& out) {
+    if (cacheMutex == nullptr) return false;
+    xSemaphoreTake(cacheMutex, portMAX_DELAY);
+    int slot = findEntry(key, fingerprint);
+    bool found = slot >= 0 && cache[slot].status == GATT_DONE && !expired(cache[slot], millis());
+    if (found) out = cache[slot];
+    xSemaphoreGive(cacheMutex);
+    return found;
+}
+
+// Copy interrogation results onto a tracked device (loop() only, since
+// InternedName is not thread-safe)
+static void attach(TrackedDevice& dev, const GattInfo& info) {
+    dev.battery = info.battery;
+    dev.manufacturer = info.manufacturer;
+    dev.model = info.model;
+}
+
+void gatt_service() {
+    if (requestQueue == nullptr) return;
+
+    // Queue new or approaching BLE devices, or attach what is cached
+    TrackingEvent ev;
+    while (events_poll(gattEvents, ev)) {
+        if (ev.deviceType != TYPE_BLUETOOTH) continue;
+        if (ev.type != EVENT_DISCOVERED && ev.type != EVENT_APPROACH) continue;
+
+        TrackedDevice* dev = tracking_getDeviceByKey(ev.key);
+        if (dev == nullptr) continue;
+
+        GattInfo info;
+        if (gatt_lookup(dev->key, dev->fingerprint, info)) {
+            attach(*dev, info);
+        } else if (ev.rssi >= GATT_MIN_RSSI) {
+            gatt_request(dev->key, dev->addrKey, dev->fingerprint, dev->addrType);
+        }
+    }
+    events_takeDropped(gattEvents);
+
+    // Results the workers finished since the last call
+    GattInfo done[4];
+    int count = 0;
+
+    xSemaphoreTake(cacheMutex, portMAX_DELAY);
+    for (int i = 0; i < GATT_CACHE_SIZE && count < 4; i++) {
+        if (!attached[i] && cache[i].status != GATT_PENDING) {
+            done[count++] = cache[i];
+            attached[i] = true;
+        }
+    }
+    xSemaphoreGive(cacheMutex);
+
+    for (int i = 0; i < count; i++) {
+        if (done[i].status != GATT_DONE) continue;
+
+        TrackedDevice* dev = tracking_getDeviceByKey(done[i].key);
+        if (dev != nullptr) {
+            attach(*dev, done[i]);
+        }
+    }
+}
+
+void gatt_printStats() {
+    if (cacheMutex == nullptr) return;
+    int cached = 0, pending = 0;
+
+    xSemaphoreTake(cacheMutex, portMAX_DELAY);
+    for (const auto& info : cache) {
+        if (info.key == 0) continue;
+        if (info.status == GATT_PENDING) pending++;
+        else cached++;
+    }
+    xSemaphoreGive(cacheMutex);
+
+    Serial.println("\n=== GATT Probe ===");
+    Serial.printf("Cached: %d, pending: %d\n", cached, pending);
+    Serial.printf("Interrogations: %u (%u failed), cache hits: %u\n",
+                  interrogations, failures, cacheHits);
+    if (queueFull > 0) {
+        Serial.printf("Skipped (queue full): %u\n", queueFull);
+    }
+    Serial.println("==================\n");
+}
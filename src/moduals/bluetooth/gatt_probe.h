@@ -0,0 +1,82 @@
+#pragma once
+#include <Arduino.h>
+
+// Background GATT interrogation of nearby BLE devices.
+//
+// Newly discovered (or approaching) BLE devices are queued for a short
+// connection that reads Device Information (manufacturer, model) and the
+// Battery level. A small pool of worker tasks drains the queue, so at most
+// GATT_MAX_CONCURRENT connections are open at once and the scan loop never
+// blocks on a connect. Results (including failures) go into a fixed cache
+// keyed by the device's stable key, with the advertisement fingerprint as a
+// second key for rotating addresses; the current address is only used to
+// connect. Entries are reused until their TTL runs out, so a device seen
+// again never triggers another connection. Devices of the same model
+// usually share a fingerprint, so a rotated handset may be shown the result
+// of an identical one.
+//
+// gatt_service() runs from loop(): it feeds the queue from the event bus
+// and copies finished results onto the tracked devices.
+//
+// A worker holds the radio (see bt_lockRadio) while it connects, so every
+// attempt is cut off after GATT_CONNECT_TIMEOUT, on core 2.x as on 3.x.
+
+// Worker tasks, i.e. simultaneous connections
+#ifndef GATT_MAX_CONCURRENT
+#define GATT_MAX_CONCURRENT 2
+#endif
+
+#ifndef GATT_CACHE_SIZE
+#define GATT_CACHE_SIZE 64
+#endif
+
+// How long results are reused before a device is interrogated again (ms)
+#ifndef GATT_CACHE_TTL
+#define GATT_CACHE_TTL (30 * 60 * 1000UL)
+#endif
+
+// Failed attempts are not retried before this (ms)
+#define GATT_FAIL_TTL (5 * 60 * 1000UL)
+
+// Connection setup and whole-interrogation deadlines (ms)
+#define GATT_CONNECT_TIMEOUT 4000
+#define GATT_JOB_TIMEOUT 8000
+
+// Too weak to be worth a connection attempt
+#define GATT_MIN_RSSI -80
+
+#define GATT_TEXT_LEN 20
+
+enum GattStatus : uint8_t {
+    GATT_PENDING,   // Queued or being interrogated
+    GATT_DONE,      // Connected; fields hold whatever the device offered
+    GATT_FAILED     // Connection failed or timed out
+};
+
+struct GattInfo {
+    uint64_t key;                   // Stable device key (see TrackedDevice::key)
+    uint32_t fingerprint;           // Advertisement fingerprint, 0 if none
+    GattStatus status;
+    int8_t battery;                 // Percent, -1 if not offered
+    char manufacturer[GATT_TEXT_LEN + 1];
+    char model[GATT_TEXT_LEN + 1];
+    unsigned long fetchedAt;        // millis() when the status was set
+};
+
+// Create the queue, cache and worker tasks (after bt_init)
+void gatt_init();
+
+// Queue a device unless it is cached, already queued or the queue is full.
+// key identifies the device in the cache; addrKey is the address to
+// connect to. Returns true if a new interrogation was queued.
+bool gatt_request(uint64_t key, uint64_t addrKey, uint32_t fingerprint, uint8_t addrType);
+
+// Copy a fresh cache entry for a device key (or, failing that, a fingerprint)
+bool gatt_lookup(uint64_t key, uint32_t fingerprint, GattInfo& out);
+
+// Queue candidates from the event bus and attach finished results to the
+// tracked devices. Call from loop().
+void gatt_service();
+
+// Print cache and queue counters
+void gatt_printStats();
@@ -1,5 +1,9 @@
 #include "display.h"
 #include "../tracking/tracking.h"
+#include "../tracking/device_cursor.h"
+#include "../events/events.h"
+#include "../utils/rssi_kernels.h"
+#include "../wifi/channel_stats.h"
 #include <Wire.h>
 #include <math.h>
 #include <algorithm>
@@ -14,12 +18,95 @@ Adafruit_SSD1306 display(128, 64, &Wire, -1);
 #define RADAR_CENTER_Y 32
 #define RADAR_MAX_RADIUS 30
 #define MAX_DISPLAY_DISTANCE 20.0f  // meters
+#define RADAR_CHUNK 64
 #define SCK_PIN 12
 #define SDA_PIN 11
 // Animation
 static int radarAngle = 0;
 
+// Devices stay ringed on the radar this long after discovery
+#define NEW_HIGHLIGHT_MS 3000
+#define MAX_RECENT_NEW 16
+
+// Recently discovered devices, fed from the event bus
+struct RecentDevice {
+    uint64_t key;
+    unsigned long time;
+};
+static RecentDevice recentNew[MAX_RECENT_NEW];
+static int recentNewNext = 0;
+static int displayEvents = -1;
+
+// Consume tracker events; only discoveries matter to the radar
+static void pollEvents() {
+    TrackingEvent ev;
+    while (events_poll(displayEvents, ev)) {
+        if (ev.type == EVENT_DISCOVERED) {
+            recentNew[recentNewNext] = { ev.key, ev.time };
+            recentNewNext = (recentNewNext + 1) % MAX_RECENT_NEW;
+        }
+    }
+    events_takeDropped(displayEvents);
+}
+
+// List rows rasterized once and blitted while their text is unchanged; the
+// selected row is the same bitmap drawn inverted
+#define ROW_WIDTH 128
+#define ROW_HEIGHT 10
+#define ROW_CACHE_SLOTS 8
+
+struct RowCacheSlot {
+    uint64_t key;
+    char text[28];
+    uint32_t lastUsed;
+    GFXcanvas1* canvas;
+};
+static RowCacheSlot rowCache[ROW_CACHE_SLOTS];
+static uint32_t rowFrame = 0;
+
+// Bitmap for a row, re-rasterized only if the device's text changed.
+// nullptr if the row canvases could not be allocated.
+static GFXcanvas1* rowBitmap(uint64_t key, const char* text) {
+    RowCacheSlot* slot = &rowCache[0];
+    for (auto& candidate : rowCache) {
+        if (candidate.key == key) {
+            slot = &candidate;
+            break;
+        }
+        if (candidate.lastUsed < slot->lastUsed) slot = &candidate;
+    }
+    if (slot->canvas == nullptr || slot->canvas->getBuffer() == nullptr) return nullptr;
+    slot->lastUsed = rowFrame;
+    
+    if (slot->key != key || strcmp(slot->text, text) != 0) {
+        slot->key = key;
+        strncpy(slot->text, text, sizeof(slot->text) - 1);
+        slot->text[sizeof(slot->text) - 1] = '\0';
+        
+        GFXcanvas1* canvas = slot->canvas;
+        canvas->fillScreen(0);
+        canvas->setTextColor(1);
+        canvas->setCursor(2, 1);
+        canvas->print(slot->text);
+    }
+    return slot->canvas;
+}
+
+static bool isRecentlyNew(uint64_t key, unsigned long now) {
+    for (const auto& recent : recentNew) {
+        if (recent.key == key && now - recent.time < NEW_HIGHLIGHT_MS) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void display_init() {
+    // Row canvases first: the views draw with them even if the panel is absent
+    for (auto& slot : rowCache) {
+        slot.canvas = new GFXcanvas1(ROW_WIDTH, ROW_HEIGHT);
+    }
+    
     // Force Pins for ESP32-S3
     Wire.begin(SCK_PIN, SDA_PIN); 
 
@@ -40,6 +127,11 @@ void display_init() {
     display.setCursor(10, 40);
     display.println("TRACKER");
     display.display(); 
+    
+    displayEvents = events_subscribe("display");
+    if (displayEvents < 0) {
+        Serial.println("Display: no event feed, new-device alerts disabled");
+    }
 }
 
 void display_radar() {
@@ -64,16 +156,29 @@ void display_radar() {
     display.drawLine(RADAR_CENTER_X, RADAR_CENTER_Y, x2, y2, SSD1306_WHITE);
     
     // Get all tracked devices
-    std::vector<TrackedDevice> devices = tracking_getAllDevices();
+    const std::vector<TrackedDevice>& devices = tracking_view();
+    unsigned long now = millis();
+    pollEvents();
     
-    // Plot devices on radar
-    for (const auto& dev : devices) {
-        // Calculate position based on distance
-        // Both are now doubles
-
-        // Use (std::min) with parentheses to prevent macro expansion
-        float normalizedDist = (std::min)((float)(dev.distance / MAX_DISPLAY_DISTANCE), 1.0f);
-        int plotRadius = normalizedDist * RADAR_MAX_RADIUS;
+    // Plot devices on radar, converting distances to radii a chunk at a time
+    float chunkDistance[RADAR_CHUNK];
+    uint8_t chunkRadius[RADAR_CHUNK];
+    
+    for (size_t i = 0; i < devices.size(); i++) {
+        const auto& dev = devices[i];
+        int slot = i % RADAR_CHUNK;
+        
+        if (slot == 0) {
+            // Use (std::min) with parentheses to prevent macro expansion
+            int n = (std::min)((size_t)RADAR_CHUNK, devices.size() - i);
+            for (int j = 0; j < n; j++) {
+                chunkDistance[j] = devices[i + j].distance;
+            }
+            // Unknown distances land on the outer ring
+            rssi_bucketBatch(chunkDistance, chunkRadius, n,
+                             MAX_DISPLAY_DISTANCE / RADAR_MAX_RADIUS, RADAR_MAX_RADIUS);
+        }
+        int plotRadius = chunkRadius[slot];
         
         // Use lastSeen time to create a pseudo-angle distribution
         // This spreads devices around the circle instead of overlapping
@@ -95,7 +200,7 @@ void display_radar() {
         }
         
         // Mark new devices with a ring
-        if (dev.isNew) {
+        if (isRecentlyNew(dev.key, now)) {
             display.drawCircle(x, y, 4, SSD1306_WHITE);
         }
     }
@@ -112,59 +217,76 @@ void display_radar() {
     display.display();
 }
 
-void display_list(int selectedIndex) {
+void display_list() {
     display.clearDisplay();
     
-    std::vector<TrackedDevice> devices = tracking_getAllDevices();
+    // Only the visible rows are fetched (see device_cursor.h)
+    const CursorPage& page = cursor_page();
+    rowFrame++;
     
     // Title
     display.setTextSize(0.5);
+    display.setTextColor(SSD1306_WHITE);
     display.setCursor(0, 0);
-    display.println("Device List");
+    display.printf("Devices by %s", cursor_orderName(cursor_order()));
+    if (page.total > 0) {
+        display.setCursor(92, 0);
+        display.printf("%d/%d", page.firstRank + page.selectedRow + 1, page.total);
+    }
     display.drawLine(0, 10, 128, 10, SSD1306_WHITE);
     
-    // Display up to 5 devices
-    int startIdx = std::max(0, selectedIndex - 2);
-    for (int i = 0; i < 5 && (startIdx + i) < devices.size(); i++) {
-        int idx = startIdx + i;
+    char text[28];
+    for (int i = 0; i < page.count; i++) {
+        const TrackedDevice* dev = tracking_getDeviceByKey(page.keys[i]);
+        if (dev == nullptr) continue;
         int y = 12 + i * 10;
         
-        // Highlight selected
-        if (idx == selectedIndex) {
-            display.fillRect(0, y, 128, 10, SSD1306_WHITE);
-            display.setTextColor(SSD1306_BLACK);
-        } else {
-            display.setTextColor(SSD1306_WHITE);
-        }
+        const char* displayName = dev->name.isEmpty() ? 
+            dev->mac.c_str() : dev->name.c_str();
         
-        display.setCursor(2, y + 1);
+        char typeChar = dev->type == TYPE_WIFI_AP ? 'W' : 
+                        dev->type == TYPE_BLUETOOTH ? 'B' : 'C';
         
-        const TrackedDevice& dev = devices[idx];
-        String displayName = dev.name.isEmpty() ? 
-            dev.mac.substring(0, 10) : dev.name.substring(0, 10);
+        snprintf(text, sizeof(text), "%c %.10s %.1fm", typeChar, displayName, dev->distance);
+        GFXcanvas1* row = rowBitmap(dev->key, text);
         
-        char typeChar = dev.type == TYPE_WIFI_AP ? 'W' : 
-                        dev.type == TYPE_BLUETOOTH ? 'B' : 'C';
+        // No canvas memory: draw the text directly
+        if (row == nullptr) {
+            bool selected = i == page.selectedRow;
+            display.fillRect(0, y, ROW_WIDTH, ROW_HEIGHT, selected ? SSD1306_WHITE : SSD1306_BLACK);
+            display.setTextColor(selected ? SSD1306_BLACK : SSD1306_WHITE);
+            display.setCursor(2, y + 1);
+            display.print(text);
+            display.setTextColor(SSD1306_WHITE);
+            continue;
+        }
         
-        display.printf("%c %s %.1fm", typeChar, displayName.c_str(), dev.distance);
+        // Highlight selected
+        if (i == page.selectedRow) {
+            display.drawBitmap(0, y, row->getBuffer(), ROW_WIDTH, ROW_HEIGHT,
+                               SSD1306_BLACK, SSD1306_WHITE);
+        } else {
+            display.drawBitmap(0, y, row->getBuffer(), ROW_WIDTH, ROW_HEIGHT,
+                               SSD1306_WHITE, SSD1306_BLACK);
+        }
     }
     
     display.display();
 }
 
-void display_detail(int deviceIndex) {
+void display_detail() {
     display.clearDisplay();
     
-    std::vector<TrackedDevice> devices = tracking_getAllDevices();
+    const TrackedDevice* selected = cursor_selected();
     
-    if (deviceIndex >= devices.size()) {
+    if (selected == nullptr) {
         display.setCursor(0, 0);
         display.println("No device");
         display.display();
         return;
     }
     
-    const TrackedDevice& dev = devices[deviceIndex];
+    const TrackedDevice& dev = *selected;
     
     display.setTextSize(0.5);
     display.setTextColor(SSD1306_WHITE);
@@ -187,18 +309,25 @@ void display_detail(int deviceIndex) {
     if (dev.name.isEmpty()) {
         display.println("Unknown");
     } else {
-        display.println(dev.name.substring(0, 12));
+        display.printf("%.12s\n", dev.name.c_str());
     }
     
-    // MAC Address
+    // Model from GATT interrogation, if any; otherwise label the MAC
     display.setCursor(0, 24);
-    display.print("MAC:");
+    if (!dev.model.isEmpty() || !dev.manufacturer.isEmpty()) {
+        display.printf("%.10s %.10s", dev.manufacturer.c_str(), dev.model.c_str());
+    } else {
+        display.print("MAC:");
+    }
     display.setCursor(0, 32);
     display.println(dev.mac.substring(0, 17));
     
     // Signal Strength
     display.setCursor(0, 42);
     display.printf("RSSI: %d dBm", dev.rssi);
+    if (dev.battery >= 0) {
+        display.printf(" B:%d%%", dev.battery);
+    }
     
     // Distance
     display.setCursor(0, 52);
@@ -207,6 +336,54 @@ void display_detail(int deviceIndex) {
     display.display();
 }
 
+// Airtime bar per channel for the last analytics window
+void display_channels() {
+    display.clearDisplay();
+    display.setTextSize(0.5);
+    display.setTextColor(SSD1306_WHITE);
+    
+    ChannelSummary summary;
+    uint8_t busiest = 0;
+    float busiestAir = 0;
+    uint32_t totalFrames = 0;
+    
+    const int barWidth = 8;
+    const int barGap = 1;
+    const int baseY = 54;
+    const int maxHeight = 40;
+    
+    for (uint8_t ch = 1; ch <= CHSTATS_CHANNELS; ch++) {
+        if (!chstats_getChannel(ch, summary)) continue;
+        totalFrames += summary.frames;
+        if (summary.airtimePercent > busiestAir) {
+            busiestAir = summary.airtimePercent;
+            busiest = ch;
+        }
+        
+        int x = 4 + (ch - 1) * (barWidth + barGap);
+        int h = summary.airtimePercent * maxHeight / 100;
+        if (summary.frames > 0 && h == 0) h = 1;
+        display.drawRect(x, baseY - maxHeight, barWidth, maxHeight, SSD1306_WHITE);
+        display.fillRect(x, baseY - h, barWidth, h, SSD1306_WHITE);
+    }
+    
+    display.setCursor(0, 0);
+    if (totalFrames == 0) {
+        display.print("No sniffer data yet");
+    } else {
+        display.printf("Busiest: ch%u %.0f%%", busiest, busiestAir);
+    }
+    
+    // Label the non-overlapping channels
+    const uint8_t labels[] = { 1, 6, 11 };
+    for (uint8_t ch : labels) {
+        display.setCursor(4 + (ch - 1) * (barWidth + barGap), baseY + 2);
+        display.print(ch);
+    }
+    
+    display.display();
+}
+
 void display_message(const char* message) {
     display.clearDisplay();
     display.setTextSize(0.5);
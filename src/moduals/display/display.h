@@ -9,8 +9,9 @@ void display_init();
 
 // Display modes
 void display_radar();
-void display_list(int selectedIndex);
-void display_detail(int deviceIndex);
+void display_list();     // Page around the cursor selection (device_cursor.h)
+void display_detail();   // The cursor's selected device
+void display_channels();
 
 // Utility displays
 void display_message(const char* message);
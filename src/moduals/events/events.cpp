@@ -0,0 +1,97 @@
+#include "events.h"
+
+struct Subscriber {
+    const char* name;
+    uint32_t cursor;     // Sequence number of the next event to read
+    uint32_t dropped;
+    bool active;
+};
+
+static TrackingEvent queue[EVENT_QUEUE_SIZE];
+static uint32_t nextSeq = 0;
+static Subscriber subscribers[MAX_EVENT_SUBSCRIBERS];
+
+static int approachThreshold = -60;
+static int departThreshold = -65;
+
+void events_init() {
+    nextSeq = 0;
+    for (auto& sub : subscribers) {
+        sub.active = false;
+    }
+}
+
+int events_subscribe(const char* name) {
+    for (int i = 0; i < MAX_EVENT_SUBSCRIBERS; i++) {
+        if (!subscribers[i].active) {
+            subscribers[i].name = name;
+            subscribers[i].cursor = nextSeq;
+            subscribers[i].dropped = 0;
+            subscribers[i].active = true;
+            return i;
+        }
+    }
+    
+    Serial.printf("[EVENTS] No subscriber slot for %s\n", name);
+    return -1;
+}
+
+void events_publish(TrackingEventType type, DeviceType deviceType, int rssi, uint64_t key) {
+    TrackingEvent& ev = queue[nextSeq % EVENT_QUEUE_SIZE];
+    ev.seq = nextSeq;
+    ev.type = type;
+    ev.deviceType = deviceType;
+    ev.rssi = (int8_t)rssi;
+    ev.key = key;
+    ev.time = millis();
+    nextSeq++;
+}
+
+bool events_poll(int subscriber, TrackingEvent& out) {
+    if (subscriber < 0 || subscriber >= MAX_EVENT_SUBSCRIBERS) return false;
+    Subscriber& sub = subscribers[subscriber];
+    
+    if (sub.cursor == nextSeq) return false;
+    
+    // Overwritten while this subscriber was away: skip to the oldest kept
+    if (nextSeq - sub.cursor > EVENT_QUEUE_SIZE) {
+        uint32_t oldest = nextSeq - EVENT_QUEUE_SIZE;
+        sub.dropped += oldest - sub.cursor;
+        sub.cursor = oldest;
+    }
+    
+    out = queue[sub.cursor % EVENT_QUEUE_SIZE];
+    sub.cursor++;
+    return true;
+}
+
+uint32_t events_takeDropped(int subscriber) {
+    if (subscriber < 0 || subscriber >= MAX_EVENT_SUBSCRIBERS) return 0;
+    uint32_t dropped = subscribers[subscriber].dropped;
+    subscribers[subscriber].dropped = 0;
+    return dropped;
+}
+
+void events_setApproachThreshold(int rssi, int hysteresis) {
+    approachThreshold = rssi;
+    departThreshold = rssi - hysteresis;
+}
+
+int events_getApproachThreshold() {
+    return approachThreshold;
+}
+
+int events_getDepartThreshold() {
+    return departThreshold;
+}
+
+const char* events_typeName(TrackingEventType type) {
+    switch (type) {
+        case EVENT_DISCOVERED:   return "NEW";
+        case EVENT_LOST:         return "LOST";
+        case EVENT_APPROACH:     return "NEAR";
+        case EVENT_DEPART:       return "AWAY";
+        case EVENT_NAME_CHANGED: return "RENAMED";
+        default:                 return "?";
+    }
+}
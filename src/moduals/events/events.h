@@ -0,0 +1,59 @@
+#pragma once
+#include <Arduino.h>
+#include "../wifi/wifi_scanner.h"
+
+// Bounded multi-subscriber event queue fed by tracking_update().
+//
+// Events go into a fixed ring and every subscriber reads through its own
+// cursor, so a slow consumer never blocks the tracker or the other
+// consumers. When a subscriber falls more than EVENT_QUEUE_SIZE events
+// behind, the oldest events are skipped and counted as dropped for that
+// subscriber only. Publisher and subscribers all run from loop(), so no
+// locking is done.
+
+#define EVENT_QUEUE_SIZE 128
+// serial, led, display, gatt, scheduler and store, with room to spare
+#ifndef MAX_EVENT_SUBSCRIBERS
+#define MAX_EVENT_SUBSCRIBERS 10
+#endif
+
+enum TrackingEventType : uint8_t {
+    EVENT_DISCOVERED,     // Device entered the table
+    EVENT_LOST,           // Device timed out
+    EVENT_APPROACH,       // RSSI rose above the approach threshold
+    EVENT_DEPART,         // RSSI fell back below it (with hysteresis)
+    EVENT_NAME_CHANGED    // Name/SSID differs from the previous sighting
+};
+
+struct TrackingEvent {
+    uint32_t seq;              // Monotonic sequence number
+    TrackingEventType type;
+    DeviceType deviceType;
+    int8_t rssi;
+    uint64_t key;              // Packed MAC (see utils/mac_key.h)
+    unsigned long time;        // millis() when emitted
+};
+
+// Reset the queue and all subscribers
+void events_init();
+
+// Register a consumer; returns its id or -1 when all slots are taken.
+// New subscribers only see events published after they subscribe.
+int events_subscribe(const char* name);
+
+// Append an event, overwriting the oldest one if the ring is full
+void events_publish(TrackingEventType type, DeviceType deviceType, int rssi, uint64_t key);
+
+// Fetch the next event for a subscriber; false when caught up
+bool events_poll(int subscriber, TrackingEvent& out);
+
+// Events this subscriber lost to overflow since the last call (resets it)
+uint32_t events_takeDropped(int subscriber);
+
+// RSSI threshold for APPROACH/DEPART and the hysteresis below it
+void events_setApproachThreshold(int rssi, int hysteresis = 5);
+int events_getApproachThreshold();
+int events_getDepartThreshold();
+
+// Printable name of an event type
+const char* events_typeName(TrackingEventType type);
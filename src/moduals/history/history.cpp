@@ -0,0 +1,269 @@
+#include "history.h"
+#include <esp_heap_caps.h>
+#include <algorithm>
+#include "../utils/key_index.h"
+
+struct HistoryLevel {
+    uint16_t buckets;   // Ring length
+    uint16_t span;      // Seconds per bucket
+    uint16_t offset;    // First bucket of this level inside a slot
+};
+
+static const HistoryLevel LEVELS[HISTORY_LEVELS] = {
+    { 60,   1,   0 },   // 1 s for the last minute
+    { 60,  60,  60 },   // 1 min for the last hour
+    { 96, 900, 120 },   // 15 min for the last day
+};
+const int HISTORY_BUCKETS = 60 + 60 + 96;
+
+// Sightings closer together than this count as continuous presence
+const uint32_t PRESENCE_GAP = 15; // Seconds
+
+// Hard cap on slots, sized so the key index stays half empty
+const int MAX_HISTORY_SLOTS = 1024;
+
+// Slots inspected per eviction when the pool is full
+const int EVICT_PROBES = 8;
+
+const int8_t NO_RSSI = -128;
+
+struct HistorySlot {
+    uint64_t key;
+    uint32_t firstSeen;
+    uint32_t lastSeen;
+    uint32_t present;                       // Total present seconds
+    uint32_t head[HISTORY_LEVELS];          // Bucket number of the newest bucket
+    int32_t rssiSum[HISTORY_LEVELS];        // Accumulators for the open bucket
+    uint16_t rssiCount[HISTORY_LEVELS];
+    uint32_t presentBefore[HISTORY_BUCKETS]; // Presence total when the bucket opened
+    int8_t rssi[HISTORY_BUCKETS];            // Average RSSI of closed buckets
+};
+
+static HistorySlot* slots = nullptr;
+static int slotCapacity = 0;
+static int slotsUsed = 0;
+static int evictHand = 0;
+static bool slotsInPsram = false;
+static KeyIndex<MAX_HISTORY_SLOTS * 2> slotIndex;
+
+static uint32_t nowSeconds() {
+    return millis() / 1000;
+}
+
+void history_init() {
+    size_t budget = psramFound() ? HISTORY_BUDGET_PSRAM : HISTORY_BUDGET_INTERNAL;
+    int capacity = (std::min)((int)(budget / sizeof(HistorySlot)), MAX_HISTORY_SLOTS);
+
+    // Shrink the pool until an allocation succeeds
+    while (capacity > 0 && slots == nullptr) {
+        size_t bytes = capacity * sizeof(HistorySlot);
+        if (psramFound()) {
+            slots = (HistorySlot*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+            slotsInPsram = slots != nullptr;
+        }
+        if (slots == nullptr) {
+            slots = (HistorySlot*)malloc(bytes);
+        }
+        if (slots == nullptr) {
+            capacity /= 2;
+        }
+    }
+
+    slotCapacity = capacity;
+    history_clear();
+
+    Serial.printf("History initialized: %d slots (%u bytes each) in %s\n",
+                  slotCapacity, sizeof(HistorySlot), slotsInPsram ? "PSRAM" : "RAM");
+}
+
+void history_clear() {
+    slotsUsed = 0;
+    evictHand = 0;
+    slotIndex.clear();
+}
+
+// Advance one level's ring to the bucket containing nowSec
+static void rollLevel(HistorySlot& slot, int level, uint32_t nowSec) {
+    const HistoryLevel& lv = LEVELS[level];
+    uint32_t bucket = nowSec / lv.span;
+    if (bucket == slot.head[level]) return;
+
+    // Close the open bucket with its average RSSI
+    slot.rssi[lv.offset + slot.head[level] % lv.buckets] = slot.rssiCount[level] > 0 ?
+        (int8_t)(slot.rssiSum[level] / slot.rssiCount[level]) : NO_RSSI;
+    slot.rssiSum[level] = 0;
+    slot.rssiCount[level] = 0;
+
+    // Open every bucket up to now; nothing was present in between
+    uint32_t steps = (std::min)(bucket - slot.head[level], (uint32_t)lv.buckets);
+    for (uint32_t b = bucket - steps + 1; b <= bucket; b++) {
+        int idx = lv.offset + b % lv.buckets;
+        slot.presentBefore[idx] = slot.present;
+        slot.rssi[idx] = NO_RSSI;
+    }
+    slot.head[level] = bucket;
+}
+
+static HistorySlot* findSlot(uint64_t key) {
+    uint16_t idx = slotIndex.find(key);
+    return idx == slotIndex.NONE ? nullptr : &slots[idx];
+}
+
+static HistorySlot* createSlot(uint64_t key, uint32_t nowSec) {
+    int idx;
+
+    if (slotsUsed < slotCapacity) {
+        idx = slotsUsed++;
+    } else {
+        // Pool full: evict the stalest of a few slots after the clock hand
+        idx = evictHand;
+        for (int i = 1; i < EVICT_PROBES; i++) {
+            int probe = (evictHand + i) % slotCapacity;
+            if (slots[probe].lastSeen < slots[idx].lastSeen) idx = probe;
+        }
+        evictHand = (evictHand + EVICT_PROBES) % slotCapacity;
+        slotIndex.erase(slots[idx].key);
+    }
+
+    HistorySlot& slot = slots[idx];
+    slot.key = key;
+    slot.firstSeen = nowSec;
+    slot.lastSeen = nowSec;
+    slot.present = 0;
+    for (int l = 0; l < HISTORY_LEVELS; l++) {
+        slot.head[l] = nowSec / LEVELS[l].span;
+        slot.rssiSum[l] = 0;
+        slot.rssiCount[l] = 0;
+    }
+    memset(slot.presentBefore, 0, sizeof(slot.presentBefore));
+    memset(slot.rssi, NO_RSSI, sizeof(slot.rssi));
+
+    slotIndex.insert(key, idx);
+    return &slot;
+}
+
+void history_record(uint64_t key, int rssi, unsigned long nowMs) {
+    if (slotCapacity == 0 || key == 0) return;
+
+    uint32_t nowSec = nowMs / 1000;
+    HistorySlot* slot = findSlot(key);
+    uint32_t credit;
+
+    if (slot == nullptr) {
+        slot = createSlot(key, nowSec);
+        credit = 1;
+    } else {
+        uint32_t gap = nowSec - slot->lastSeen;
+        credit = gap == 0 ? 0 : (gap <= PRESENCE_GAP ? gap : 1);
+    }
+
+    for (int l = 0; l < HISTORY_LEVELS; l++) {
+        rollLevel(*slot, l, nowSec);
+        slot->rssiSum[l] += rssi;
+        slot->rssiCount[l]++;
+    }
+
+    slot->present += credit;
+    slot->lastSeen = nowSec;
+}
+
+// Dwell inside the window, answered from the finest level that covers it
+static uint32_t slotDwell(const HistorySlot& slot, uint32_t windowSec, uint32_t nowSec) {
+    int level = HISTORY_LEVELS - 1;
+    for (int l = 0; l < HISTORY_LEVELS; l++) {
+        if ((uint32_t)LEVELS[l].buckets * LEVELS[l].span >= windowSec) {
+            level = l;
+            break;
+        }
+    }
+
+    const HistoryLevel& lv = LEVELS[level];
+    uint32_t start = (nowSec - (std::min)(windowSec, nowSec)) / lv.span;
+    uint32_t head = slot.head[level];
+
+    // Not seen since the window opened
+    if (start > head) return 0;
+
+    // Clamp to the oldest bucket still in the ring
+    if (head - start >= lv.buckets) {
+        start = head - lv.buckets + 1;
+    }
+
+    return slot.present - slot.presentBefore[lv.offset + start % lv.buckets];
+}
+
+uint32_t history_dwellSeconds(uint64_t key, uint32_t windowSec) {
+    HistorySlot* slot = findSlot(key);
+    return slot ? slotDwell(*slot, windowSec, nowSeconds()) : 0;
+}
+
+bool history_wasPresent(uint64_t key, uint32_t windowSec) {
+    HistorySlot* slot = findSlot(key);
+    return slot && nowSeconds() - slot->lastSeen <= windowSec;
+}
+
+int history_countPresent(uint32_t windowSec) {
+    uint32_t nowSec = nowSeconds();
+    int count = 0;
+
+    for (int i = 0; i < slotsUsed; i++) {
+        if (nowSec - slots[i].lastSeen <= windowSec) count++;
+    }
+    return count;
+}
+
+int history_getPresent(uint32_t windowSec, HistoryInfo* out, int maxCount) {
+    uint32_t nowSec = nowSeconds();
+    int count = 0;
+
+    for (int i = 0; i < slotsUsed && count < maxCount; i++) {
+        const HistorySlot& slot = slots[i];
+        if (nowSec - slot.lastSeen > windowSec) continue;
+
+        out[count].key = slot.key;
+        out[count].firstSeen = slot.firstSeen;
+        out[count].lastSeen = slot.lastSeen;
+        out[count].dwellSeconds = slotDwell(slot, windowSec, nowSec);
+        count++;
+    }
+    return count;
+}
+
+int history_getRSSISeries(uint64_t key, int level, int8_t* out, int count) {
+    if (level < 0 || level >= HISTORY_LEVELS) return 0;
+
+    HistorySlot* slot = findSlot(key);
+    if (slot == nullptr) return 0;
+
+    const HistoryLevel& lv = LEVELS[level];
+    count = (std::min)(count, (int)lv.buckets);
+    int64_t nowBucket = nowSeconds() / lv.span;
+    int64_t head = slot->head[level];
+
+    for (int i = 0; i < count; i++) {
+        int64_t b = nowBucket - (count - 1 - i);
+
+        if (b > head || b < 0 || head - b >= lv.buckets) {
+            out[i] = NO_RSSI;
+        } else if (b == head) {
+            // Still open: report the running average
+            out[i] = slot->rssiCount[level] > 0 ?
+                (int8_t)(slot->rssiSum[level] / slot->rssiCount[level]) : NO_RSSI;
+        } else {
+            out[i] = slot->rssi[lv.offset + b % lv.buckets];
+        }
+    }
+    return count;
+}
+
+void history_printStats() {
+    Serial.println("\n=== Presence History ===");
+    Serial.printf("Slots: %d / %d\n", slotsUsed, slotCapacity);
+    Serial.printf("Memory: %u KB in %s\n",
+                  (unsigned)(slotCapacity * sizeof(HistorySlot) / 1024),
+                  slotsInPsram ? "PSRAM" : "RAM");
+    Serial.printf("Seen last minute: %d\n", history_countPresent(60));
+    Serial.printf("Seen last hour: %d\n", history_countPresent(3600));
+    Serial.printf("Seen last 6 hours: %d\n", history_countPresent(6 * 3600));
+    Serial.println("========================\n");
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <Arduino.h>
+
+// Per-device presence and RSSI history in a fixed memory budget.
+//
+// Each device gets three ring buffers at decreasing resolution:
+//   level 0:  60 x 1 s   (last minute)
+//   level 1:  60 x 1 min (last hour)
+//   level 2:  96 x 15 min (last day)
+// Buckets are rolled forward lazily when a device is recorded, so appends
+// are constant time and idle devices cost nothing. Every bucket stores the
+// running presence total at its start, which turns dwell-time queries into a
+// single subtraction instead of a scan over samples.
+
+#define HISTORY_LEVELS 3
+
+// Memory budget for history slots. PSRAM is used when the board has it.
+#ifndef HISTORY_BUDGET_PSRAM
+#define HISTORY_BUDGET_PSRAM (512 * 1024)
+#endif
+#ifndef HISTORY_BUDGET_INTERNAL
+#define HISTORY_BUDGET_INTERNAL (48 * 1024)
+#endif
+
+// Summary of one device's history, as returned by queries
+struct HistoryInfo {
+    uint64_t key;            // Packed MAC (see utils/mac_key.h)
+    uint32_t firstSeen;      // Seconds since boot
+    uint32_t lastSeen;       // Seconds since boot
+    uint32_t dwellSeconds;   // Presence inside the queried window
+};
+
+// Allocate the slot pool (call once at startup)
+void history_init();
+
+// Record a sighting; called from tracking_update for every device seen
+void history_record(uint64_t key, int rssi, unsigned long nowMs);
+
+// Seconds the device was present during the last windowSec seconds.
+// Resolution is that of the finest level covering the window.
+uint32_t history_dwellSeconds(uint64_t key, uint32_t windowSec);
+
+// Whether the device was seen during the last windowSec seconds
+bool history_wasPresent(uint64_t key, uint32_t windowSec);
+
+// Number of devices seen during the last windowSec seconds
+int history_countPresent(uint32_t windowSec);
+
+// Fill `out` with devices seen during the last windowSec seconds, including
+// their dwell time in that window. Returns the number written.
+int history_getPresent(uint32_t windowSec, HistoryInfo* out, int maxCount);
+
+// Copy the average RSSI of the newest `count` buckets of one level, oldest
+// first. Buckets without a sighting read as -128. Returns buckets written.
+int history_getRSSISeries(uint64_t key, int level, int8_t* out, int count);
+
+// Forget everything
+void history_clear();
+
+// Print slot usage and memory footprint
+void history_printStats();
@@ -1,10 +1,23 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <Adafruit_NeoPixel.h>
+#include <LittleFS.h>
+#include <esp_wifi.h>
 #include "display/display.h"
 #include "wifi/wifi_scanner.h"
 #include "bluetooth/bt_scanner.h"
+#include "bluetooth/gatt_probe.h"
 #include "tracking/tracking.h"
+#include "tracking/device_cursor.h"
+#include "aggregation/aggregation.h"
+#include "history/history.h"
+#include "events/events.h"
+#include "sketch/presence_sketch.h"
+#include "storage/device_store.h"
+#include "scheduler/scan_scheduler.h"
+#include "wifi/channel_stats.h"
+#include "utils/mac_key.h"
+#include "utils/rssi_kernels.h"
 
 // ESP32-S3 Specific Pins
 #define SDA_PIN 11
@@ -17,13 +30,104 @@ Adafruit_NeoPixel LED_RGB(1, LED_PIN, NEO_GRB + NEO_KHZ800);
 enum DisplayMode {
     MODE_RADAR,
     MODE_LIST,
-    MODE_DETAIL
+    MODE_DETAIL,
+    MODE_CHANNELS
 };
 
 DisplayMode currentMode = MODE_RADAR;
 unsigned long lastScan = 0;
-const unsigned long SCAN_INTERVAL = 1000; // Scan every 3 seconds
-int selectedDevice = 0;
+unsigned long lastScanMs = 0;
+bool roundPending = false;
+
+// Event bus subscribers
+int serialEvents = -1;
+int ledEvents = -1;
+
+// Serial telemetry: one line per tracker event
+void printEvents() {
+    TrackingEvent ev;
+    char mac[18];
+    
+    while (events_poll(serialEvents, ev)) {
+        mac_format(ev.key, mac);
+        const TrackedDevice* dev = tracking_getDeviceByKey(ev.key);
+        const char* name = (dev && !dev->name.isEmpty()) ? dev->name.c_str() : mac;
+        
+        Serial.printf("[%s] %s | %s | %d dBm\n", events_typeName(ev.type),
+            ev.deviceType == TYPE_WIFI_AP ? "WiFi AP" :
+            ev.deviceType == TYPE_WIFI_CLIENT ? "WiFi" : "BLE",
+            name, ev.rssi);
+    }
+    
+    uint32_t dropped = events_takeDropped(serialEvents);
+    if (dropped > 0) {
+        Serial.printf("[EVENTS] %u events dropped\n", dropped);
+    }
+}
+
+// WiFi needs the shared radio during the BLE pass (the sniffer is paused)
+bool wifiBusy() {
+    return WiFi.status() == WL_CONNECTED;
+}
+
+// LED consumer: true if any device was discovered since the last check
+bool newDeviceSeen() {
+    TrackingEvent ev;
+    bool seen = false;
+    
+    while (events_poll(ledEvents, ev)) {
+        if (ev.type == EVENT_DISCOVERED) seen = true;
+    }
+    
+    // Taken after the poll so drops during it count now (a drop may
+    // have been a discovery)
+    if (events_takeDropped(ledEvents) > 0) seen = true;
+    return seen;
+}
+
+// Serial keys: r/l/d/c pick a view, n/p move the selection, o cycles the order
+void handleSerialInput() {
+    while (Serial.available() > 0) {
+        switch (Serial.read()) {
+            case 'r': currentMode = MODE_RADAR; break;
+            case 'l': currentMode = MODE_LIST; break;
+            case 'd': currentMode = MODE_DETAIL; break;
+            case 'c': currentMode = MODE_CHANNELS; break;
+            case 'n': cursor_next(); break;
+            case 'p': cursor_prev(); break;
+            case 'o':
+                cursor_setOrder((CursorOrder)((cursor_order() + 1) % CURSOR_ORDER_COUNT));
+                break;
+        }
+    }
+}
+
+// Per-round output once the tracker has applied a scan round
+void reportRound() {
+    roundPending = false;
+    
+    // Log only what changed since the last scan
+    printEvents();
+    TrackingStats stats = tracking_stats();
+    Serial.printf("\nTotal tracked devices: %u (AP %u, client %u, BLE %u) | nearest %.1fm\n",
+                  stats.total, stats.byType[TYPE_WIFI_AP], stats.byType[TYPE_WIFI_CLIENT],
+                  stats.byType[TYPE_BLUETOOTH], stats.minDistance);
+    Serial.printf("Seen in last 6h: %d | Unique this hour: ~%u, today: ~%u\n",
+                  history_countPresent(6 * 3600),
+                  sketch_uniquesThisHour(), sketch_uniquesToday());
+    
+    // Export changed devices for the site collector
+    aggregation_publish(Serial);
+    
+    // Feed this round's churn back into the cadence
+    scheduler_report(lastScanMs, wifiBusy());
+    Serial.println("--- Scan Complete ---\n");
+    
+    // LED: Ready, or Magenta if something new showed up
+    LED_RGB.setPixelColor(0, newDeviceSeen() ?
+        LED_RGB.Color(255, 0, 255) : LED_RGB.Color(0, 255, 0));
+    LED_RGB.show();
+}
 
 void setup() {
     Serial.begin(115200);
@@ -42,6 +146,47 @@ void setup() {
     // Initialize I2C
     Wire.begin(SDA_PIN, SCK_PIN);
     
+#ifdef TRACKING_BENCHMARK
+    // Build with -D TRACKING_BENCHMARK to time tracking rounds against table
+    // size; it runs before the event bus, history and sketch, which reset
+    // whatever it leaves behind
+    tracking_init();
+    for (int count = 64; count * 3 / 2 <= MAX_TRACKED_DEVICES; count *= 2) {
+        TrackingBenchmark bench = tracking_benchmark(count, TRACKING_SLICE_US);
+        Serial.printf("Tracking, %d devices: update %u us, worst slice %u us (%d slices)\n",
+                      bench.count, bench.updateUs, bench.sliceUs, bench.slices);
+    }
+#endif
+    
+#ifdef QUERY_BENCHMARK
+    // Build with -D QUERY_BENCHMARK to compare query.h with the copying API
+    tracking_init();
+    for (int count : {64, 256, MAX_TRACKED_DEVICES}) {
+        QueryBenchmark bench = tracking_queryBenchmark(count, 20);
+        Serial.printf("Queries, %d devices x%d: nearest %u -> %u us, count %u -> %u us\n",
+                      bench.count, bench.repeat, bench.nearestLegacyUs, bench.nearestQueryUs,
+                      bench.countLegacyUs, bench.countQueryUs);
+    }
+#endif
+    
+#ifdef INTERN_BENCHMARK
+    // Build with -D INTERN_BENCHMARK to measure the name pool's heap saving
+    for (int distinct : {8, 64, 256}) {
+        InternBenchmark bench = intern_benchmark(MAX_TRACKED_DEVICES, distinct);
+        Serial.printf("Names, %d owners / %d distinct: String %ld B, interned %ld B (+%u B static)\n",
+                      bench.count, bench.distinct, bench.stringBytes, bench.internBytes,
+                      (unsigned)bench.poolBytes);
+    }
+#endif
+    
+    // Initialize event bus before anything subscribes to it
+    events_init();
+    serialEvents = events_subscribe("serial");
+    ledEvents = events_subscribe("led");
+    if (serialEvents < 0 || ledEvents < 0) {
+        Serial.println("Event bus full: serial/LED event output disabled");
+    }
+    
     // Initialize Display
     Serial.println("Initializing Display...");
     display_init();
@@ -51,77 +196,144 @@ void setup() {
     Serial.println("Initializing WiFi...");
     wifi_init();
     
+    // Sniff between scans for per-channel airtime analytics
+    chstats_init();
+    wifi_enable_promiscuous();
+    
     // Initialize Bluetooth Scanner
     Serial.println("Initializing Bluetooth...");
     bt_init();
+    gatt_init();
     
     // Initialize Tracker
     Serial.println("Initializing Tracker...");
     tracking_init();
+    history_init();
+    
+    // The flash filesystem holds the sketch and the device store
+    bool fsMounted = LittleFS.begin(true);
+    sketch_init(fsMounted ? "/littlefs" : nullptr);
+    
+    // Warm restart: reload the table saved before the last reboot
+    if (fsMounted && store_init("/littlefs")) {
+        store_restore();
+    } else {
+        Serial.println("Device store unavailable, starting empty");
+    }
+    
+    // Initialize multi-sensor export
+    aggregation_init();
+    
+    // Scan cadence follows how much the surroundings change
+    scheduler_init();
+    
+#ifdef RSSI_BENCHMARK
+    // Build with -D RSSI_BENCHMARK to time the RSSI kernels on the board
+    for (int count : {64, MAX_TRACKED_DEVICES}) {
+        RssiBenchmark bench = rssi_benchmark(count);
+        Serial.printf("RSSI kernels, %d devices: scalar %u %s, batched %u %s\n",
+                      bench.count, bench.scalarTicks, bench.unit, bench.batchTicks, bench.unit);
+    }
+#endif
     
     LED_RGB.setPixelColor(0, LED_RGB.Color(0, 255, 0)); // Green = Ready
     LED_RGB.show();
     
     Serial.println("\n=== System Ready ===");
+    Serial.println("Keys: r/l/d/c view, n/p select, o sort order");
     Serial.println("Starting scans...\n");
 }
 
 void loop() {
     unsigned long currentTime = millis();
     
-    // Perform periodic scans
-    if (currentTime - lastScan >= SCAN_INTERVAL) {
+    // Perform periodic scans, at the cadence picked by the scheduler
+    const ScanPlan& plan = scheduler_plan();
+    if (currentTime - lastScan >= plan.interval) {
         lastScan = currentTime;
         
+        // The last round is still being applied: finish and report it
+        // first, or its events and radio time would count towards this one
+        if (roundPending) {
+            tracking_endRound();
+            reportRound();
+        }
+        
         // LED: Scanning
         LED_RGB.setPixelColor(0, LED_RGB.Color(0, 0, 255)); // Blue = Scanning
         LED_RGB.show();
         
         Serial.println("--- Starting Scan ---");
         
-        // Scan WiFi
+        tracking_setTimeout(plan.deviceTimeout);
+        tracking_beginRound();
+        
+        // Pause the sniffer for both passes so BLE gets the radio to itself
+        bool sniffing = false;
+        esp_wifi_get_promiscuous(&sniffing);
+        if (sniffing) wifi_disable_promiscuous();
+        
+        // Scan WiFi channel by channel, feeding the tracker as each finishes
         Serial.println("Scanning WiFi...");
-        std::vector<Device> wifiDevices = wifi_scan();
-        Serial.printf("Found %d WiFi networks\n", wifiDevices.size());
+        WiFiChannelScan channels[WIFI_CHANNEL_COUNT];
+        int channelCount = wifi_defaultChannelPlan(channels, plan.wifiDwellMs);
+        int wifiCount = wifi_scanChannels(channels, channelCount, tracking_submitWiFi);
+        Serial.printf("Found %d WiFi networks\n", wifiCount);
         
         // Scan Bluetooth
         Serial.println("Scanning Bluetooth...");
-        std::vector<Device> btDevices = bt_scan();
+        bt_setDutyCycle(plan.bleIntervalMs, plan.bleWindowMs);
+        std::vector<Device> btDevices = bt_scan(plan.bleSeconds);
         Serial.printf("Found %d Bluetooth devices\n", btDevices.size());
         
-        // Update tracker with all devices
-        tracking_update(wifiDevices, btDevices);
-        
-        // Get all tracked devices
-        std::vector<TrackedDevice> allDevices = tracking_getAllDevices();
+        if (sniffing) wifi_enable_promiscuous();
         
-        // Print summary
-        Serial.printf("\nTotal tracked devices: %d\n", allDevices.size());
-        for (const auto& dev : allDevices) {
-            Serial.printf("  [%s] %s | %.1fm | %s\n", 
-                dev.type == TYPE_WIFI_AP ? "WiFi" : 
-                dev.type == TYPE_WIFI_CLIENT ? "Client" : "BLE",
-                dev.name.isEmpty() ? dev.mac.c_str() : dev.name.c_str(),
-                dev.distance,
-                dev.isNew ? "NEW" : "Known");
-        }
-        Serial.println("--- Scan Complete ---\n");
+        // Applied a slice per loop() below, timeouts swept last
+        tracking_submit(std::move(btDevices));
+        tracking_closeRound();
         
-        // LED: Ready
-        LED_RGB.setPixelColor(0, LED_RGB.Color(0, 255, 0)); // Green = Ready
-        LED_RGB.show();
+        lastScanMs = millis() - currentTime;
+        roundPending = true;
+    }
+    
+    // Finish the round within a bounded slice so the display keeps up
+    if (roundPending && tracking_step(TRACKING_SLICE_US)) {
+        reportRound();
     }
     
-    // Update display based on current mode
+    // Rotate and persist the unique-device sketches
+    sketch_service();
+    
+    // Flush device deltas and run any pending compaction
+    store_service();
+    
+    // Queue GATT interrogations and attach finished ones
+    gatt_service();
+    
+    // Hop the sniffer; report channel usage once per window
+    if (chstats_service()) {
+        chstats_printReport(Serial);
+    }
+    
+    // Update display based on current mode. The device views hold the
+    // last completed round until the one being applied finishes.
+    handleSerialInput();
+    if (currentMode != MODE_CHANNELS && tracking_roundInProgress()) {
+        delay(100);
+        return;
+    }
     switch (currentMode) {
         case MODE_RADAR:
             display_radar();
             break;
         case MODE_LIST:
-            display_list(selectedDevice);
+            display_list();
             break;
         case MODE_DETAIL:
-            display_detail(selectedDevice);
+            display_detail();
+            break;
+        case MODE_CHANNELS:
+            display_channels();
             break;
     }
     display.display();
@@ -0,0 +1,140 @@
+#include "scan_scheduler.h"
+#include "../events/events.h"
+
+// Duty levels, most aggressive first. The device timeout grows with the
+// round length so a slow cadence does not evict devices between rounds.
+static const ScanPlan LEVELS[] = {
+    // level interval dwell ble  int win  timeout
+    {  0,    1000,   300,  3,  100, 99,  10000 },
+    {  1,    4000,   200,  2,  100, 75,  15000 },
+    {  2,   10000,   150,  2,  100, 50,  35000 },
+    {  3,   20000,   120,  1,  100, 40,  65000 },
+};
+const int LEVEL_COUNT = sizeof(LEVELS) / sizeof(LEVELS[0]);
+
+// Churn (events per minute) that sends us straight back to level 0
+const float CHURN_BURST = 6.0;
+
+// Churn below which a round counts as quiet
+const float CHURN_QUIET = 1.0;
+
+// Quiet rounds in a row before relaxing one level
+const int QUIET_ROUNDS = 5;
+
+// Smoothing of the churn estimate (weight of the newest round)
+const float CHURN_ALPHA = 0.3;
+
+// BLE window cap while WiFi needs the shared radio
+const uint16_t COEX_BLE_WINDOW = 50;
+
+static ScanPlan plan;
+static int level = 0;
+static int quietRounds = 0;
+static float churnRate = 0;
+static bool wifiBusy = false;
+static int schedulerEvents = -1;
+static unsigned long lastReport = 0;
+
+// Radio time accounting
+static unsigned long radioMs = 0;
+static unsigned long startMs = 0;
+static uint32_t rounds = 0;
+
+static void applyLevel() {
+    plan = LEVELS[level];
+    if (wifiBusy && plan.bleWindowMs > COEX_BLE_WINDOW) {
+        plan.bleWindowMs = COEX_BLE_WINDOW;
+    }
+}
+
+void scheduler_init() {
+    level = 0;
+    quietRounds = 0;
+    churnRate = 0;
+    wifiBusy = false;
+    applyLevel();
+
+    schedulerEvents = events_subscribe("scheduler");
+    if (schedulerEvents < 0) {
+        Serial.println("Scheduler: no event feed, staying at full duty");
+    }
+    lastReport = millis();
+    startMs = lastReport;
+    radioMs = 0;
+    rounds = 0;
+}
+
+const ScanPlan& scheduler_plan() {
+    return plan;
+}
+
+// Events that mean "the environment changed"
+static int takeChurnEvents() {
+    TrackingEvent ev;
+    int count = events_takeDropped(schedulerEvents);
+
+    while (events_poll(schedulerEvents, ev)) {
+        if (ev.type != EVENT_NAME_CHANGED) count++;
+    }
+    return count;
+}
+
+void scheduler_report(unsigned long scanMs, bool busy) {
+    unsigned long now = millis();
+    unsigned long elapsed = now - lastReport;
+    lastReport = now;
+    radioMs += scanMs;
+    rounds++;
+
+    // Rate over wall time, not scan time, so it stays comparable across
+    // levels; a slower cadence simply averages over a longer window
+    int events = takeChurnEvents();
+    float rate = elapsed > 0 ? events * 60000.0 / elapsed : 0;
+    churnRate = churnRate * (1 - CHURN_ALPHA) + rate * CHURN_ALPHA;
+
+    int previous = level;
+    if (schedulerEvents < 0) {
+        // Blind to churn: never relax, or devices would be missed
+        level = 0;
+    } else if (rate >= CHURN_BURST) {
+        // React to the raw burst, not the smoothed rate
+        level = 0;
+        quietRounds = 0;
+    } else if (churnRate < CHURN_QUIET) {
+        if (++quietRounds >= QUIET_ROUNDS && level < LEVEL_COUNT - 1) {
+            level++;
+            quietRounds = 0;
+        }
+    } else {
+        quietRounds = 0;
+        if (churnRate >= CHURN_BURST / 2 && level > 0) level--;
+    }
+
+    wifiBusy = busy;
+    applyLevel();
+
+    if (level != previous) {
+        Serial.printf("[SCHED] Level %d -> %d (churn %.1f/min)\n", previous, level, churnRate);
+    }
+}
+
+float scheduler_churnRate() {
+    return churnRate;
+}
+
+void scheduler_printStats() {
+    unsigned long uptime = millis() - startMs;
+
+    Serial.println("\n=== Scan Scheduler ===");
+    Serial.printf("Level: %d (interval %lu ms, WiFi dwell %u ms, BLE %u s %u/%u ms)\n",
+                  plan.level, plan.interval, plan.wifiDwellMs, plan.bleSeconds,
+                  plan.bleWindowMs, plan.bleIntervalMs);
+    if (wifiBusy) {
+        Serial.printf("BLE window capped at %u ms (WiFi connected)\n", COEX_BLE_WINDOW);
+    }
+    Serial.printf("Churn: %.1f events/min\n", churnRate);
+    Serial.printf("Rounds: %u, radio busy %lu s of %lu s (%.0f%%)\n",
+                  rounds, radioMs / 1000, uptime / 1000,
+                  uptime > 0 ? 100.0 * radioMs / uptime : 0.0);
+    Serial.println("======================\n");
+}
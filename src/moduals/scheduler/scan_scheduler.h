@@ -0,0 +1,41 @@
+#pragma once
+#include <Arduino.h>
+
+// Churn-adaptive scan scheduling.
+//
+// Each scan round reports how many devices arrived, left or crossed the
+// approach threshold. The scheduler turns that into an event rate per
+// minute of wall time (so backing off does not itself look like a quieter
+// environment) and picks one of a few duty levels:
+//   - any burst of churn jumps straight to the most aggressive level
+//   - a run of quiet rounds relaxes one level at a time
+// WiFi and BLE share one 2.4 GHz radio; while WiFi needs it during the BLE
+// pass (a station connection) the BLE duty is capped. The sniffer does not
+// count, since it is paused for the scan passes.
+
+// Scan parameters for the next round
+struct ScanPlan {
+    uint8_t level;              // 0 = most aggressive
+    unsigned long interval;     // ms between the starts of two rounds
+    uint16_t wifiDwellMs;       // Per-channel WiFi dwell
+    uint8_t bleSeconds;         // BLE scan duration
+    uint16_t bleIntervalMs;     // BLE scan interval / window
+    uint16_t bleWindowMs;
+    unsigned long deviceTimeout; // Eviction timeout that fits this cadence
+};
+
+// Start at the aggressive level; subscribes to the event bus
+void scheduler_init();
+
+// Parameters for the next scan round
+const ScanPlan& scheduler_plan();
+
+// Report a finished round: how long the radios were busy and whether
+// WiFi will need the radio during the next BLE pass
+void scheduler_report(unsigned long scanMs, bool wifiBusy);
+
+// Churn estimate in events per minute
+float scheduler_churnRate();
+
+// Print the current level and radio time spent
+void scheduler_printStats();
@@ -0,0 +1,174 @@
+#include "presence_sketch.h"
+#include <stdio.h>
+#include <algorithm>
+
+// Save at most this often unless a rotation happened (limits flash wear)
+const unsigned long SKETCH_SAVE_INTERVAL = 10 * 60 * 1000; // 10 Minutes
+
+const uint32_t SKETCH_MAGIC = 0x534B4831; // "SKH1"
+
+// Everything that survives a reboot, saved as one file
+struct SketchState {
+    uint32_t magic;
+    uint32_t clockSec;           // Accumulated uptime at save
+    uint32_t hour;               // Hour number of the current generation
+    uint32_t day;
+    uint32_t lastHourUniques;
+    uint32_t yesterdayUniques;
+    uint8_t currentGen;
+    uint8_t bloom[SKETCH_BLOOM_HOURS][BLOOM_BYTES];
+    uint8_t hllHour[HLL_REGISTERS];
+    uint8_t hllDay[HLL_REGISTERS];
+};
+
+static SketchState state;
+static uint32_t bootClock = 0;     // Accumulated uptime when this boot started
+static unsigned long lastSave = 0;
+static bool dirty = false;
+static char sketchPath[48] = "";
+static char sketchTmpPath[48] = "";
+
+static uint32_t sketchClock() {
+    return bootClock + millis() / 1000;
+}
+
+static void resetState(uint32_t clock) {
+    memset(&state, 0, sizeof(state));
+    state.magic = SKETCH_MAGIC;
+    state.clockSec = clock;
+    state.hour = clock / 3600;
+    state.day = clock / 86400;
+}
+
+void sketch_init(const char* baseDir) {
+    bool loaded = false;
+
+    if (baseDir != nullptr) {
+        snprintf(sketchPath, sizeof(sketchPath), "%s/sketch.bin", baseDir);
+        snprintf(sketchTmpPath, sizeof(sketchTmpPath), "%s/sketch.tmp", baseDir);
+
+        FILE* f = fopen(sketchPath, "rb");
+        if (f != nullptr) {
+            loaded = fread(&state, 1, sizeof(state), f) == sizeof(state) &&
+                     state.magic == SKETCH_MAGIC;
+            fclose(f);
+        }
+    } else {
+        sketchPath[0] = '\0';
+    }
+
+    if (!loaded) {
+        resetState(0);
+    }
+    bootClock = state.clockSec;
+    lastSave = millis();
+    dirty = false;
+
+    Serial.printf("Presence sketch %s (%u bytes)\n",
+                  loaded ? "restored" : "initialized", sizeof(state));
+}
+
+bool sketch_save() {
+    // A failed save is retried on the next interval, not every loop()
+    lastSave = millis();
+    if (sketchPath[0] == '\0') return false;
+
+    state.clockSec = sketchClock();
+
+    // Write beside the old copy and swap, so a crash keeps one intact
+    FILE* f = fopen(sketchTmpPath, "wb");
+    bool ok = f != nullptr && fwrite(&state, 1, sizeof(state), f) == sizeof(state);
+    if (f != nullptr && fclose(f) != 0) ok = false;
+    ok = ok && rename(sketchTmpPath, sketchPath) == 0;
+
+    if (!ok) {
+        remove(sketchTmpPath);
+        Serial.println("[SKETCH] Save failed, will retry");
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+// Advance generations/counters to the current hour and day
+static void rotate() {
+    uint32_t clock = sketchClock();
+    uint32_t hour = clock / 3600;
+    uint32_t day = clock / 86400;
+
+    if (hour != state.hour) {
+        state.lastHourUniques = hour - state.hour == 1 ? hll_estimate(state.hllHour) : 0;
+        memset(state.hllHour, 0, sizeof(state.hllHour));
+
+        // Clear one generation per elapsed hour, at most all of them
+        uint32_t steps = (std::min)(hour - state.hour, (uint32_t)SKETCH_BLOOM_HOURS);
+        for (uint32_t i = 0; i < steps; i++) {
+            state.currentGen = (state.currentGen + 1) % SKETCH_BLOOM_HOURS;
+            memset(state.bloom[state.currentGen], 0, BLOOM_BYTES);
+        }
+        state.hour = hour;
+        dirty = true;
+    }
+
+    if (day != state.day) {
+        state.yesterdayUniques = day - state.day == 1 ? hll_estimate(state.hllDay) : 0;
+        memset(state.hllDay, 0, sizeof(state.hllDay));
+        state.day = day;
+        dirty = true;
+    }
+}
+
+void sketch_record(uint64_t key) {
+    SketchHash h = sketch_hash(key);
+
+    bloom_set(state.bloom[state.currentGen], h);
+    hll_add(state.hllHour, h.h1);
+    hll_add(state.hllDay, h.h1);
+    dirty = true;
+}
+
+bool sketch_seenRecently(uint64_t key) {
+    SketchHash h = sketch_hash(key);
+
+    for (int gen = 0; gen < SKETCH_BLOOM_HOURS; gen++) {
+        if (bloom_test(state.bloom[gen], h)) return true;
+    }
+    return false;
+}
+
+uint32_t sketch_uniquesThisHour() {
+    return hll_estimate(state.hllHour);
+}
+
+uint32_t sketch_uniquesLastHour() {
+    return state.lastHourUniques;
+}
+
+uint32_t sketch_uniquesToday() {
+    return hll_estimate(state.hllDay);
+}
+
+uint32_t sketch_uniquesYesterday() {
+    return state.yesterdayUniques;
+}
+
+void sketch_service() {
+    uint32_t hourBefore = state.hour;
+    rotate();
+
+    // Persist right after a rotation, otherwise on the save interval
+    bool rotated = state.hour != hourBefore;
+    if (dirty && (rotated || millis() - lastSave >= SKETCH_SAVE_INTERVAL)) {
+        sketch_save();
+    }
+}
+
+void sketch_printStats() {
+    Serial.println("\n=== Unique Devices (estimated) ===");
+    Serial.printf("This hour: %u (last hour: %u)\n",
+                  sketch_uniquesThisHour(), sketch_uniquesLastHour());
+    Serial.printf("Today: %u (yesterday: %u)\n",
+                  sketch_uniquesToday(), sketch_uniquesYesterday());
+    Serial.printf("Uptime clock: %u h\n", sketchClock() / 3600);
+    Serial.println("==================================\n");
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+#include "sketch_core.h"
+
+// Fixed-memory probabilistic memory of devices that already timed out of
+// the tracker:
+//   - a rotating Bloom filter answers "seen in the last N hours?" so a
+//     returning visitor can be told apart from a new one
+//   - HyperLogLog sketches count unique devices this hour and today
+// Both are updated in constant time per sighting and persisted to a file
+// on the flash filesystem (the state is ~14 KB, too big for NVS).
+//
+// There is no wall clock on the board, so hours and days are counted in
+// accumulated uptime (carried across reboots); time spent powered off does
+// not advance them.
+//
+// The Bloom/HLL primitives live in sketch_core.h; tools/sketch_bench
+// measures their accuracy and throughput on a host.
+
+// Load persisted state (or start empty) from baseDir/sketch.bin. With a
+// null baseDir the sketch lives in RAM only.
+void sketch_init(const char* baseDir);
+
+// Add a sighting of a device (packed MAC key)
+void sketch_record(uint64_t key);
+
+// Whether the device was recorded within the last SKETCH_BLOOM_HOURS.
+// May report false positives, never false negatives.
+bool sketch_seenRecently(uint64_t key);
+
+// Unique device estimates
+uint32_t sketch_uniquesThisHour();
+uint32_t sketch_uniquesLastHour();
+uint32_t sketch_uniquesToday();
+uint32_t sketch_uniquesYesterday();
+
+// Rotate generations on hour/day boundaries and save periodically.
+// Call from loop(); cheap when there is nothing to do.
+void sketch_service();
+
+// Write the state now; false (and still dirty) if the write failed
+bool sketch_save();
+
+// Print the estimates
+void sketch_printStats();
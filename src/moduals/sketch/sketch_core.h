@@ -0,0 +1,96 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// Bloom filter and HyperLogLog primitives behind the presence sketch.
+// Kept free of Arduino types so the host benchmark (tools/sketch_bench)
+// measures the exact code the board runs.
+
+// One Bloom generation per hour; "recently" means within this many hours
+#ifndef SKETCH_BLOOM_HOURS
+#define SKETCH_BLOOM_HOURS 6
+#endif
+
+// Bits per generation; ~0.5% false positives per generation at 1k devices
+#ifndef SKETCH_BLOOM_BITS
+#define SKETCH_BLOOM_BITS 16384
+#endif
+
+// HyperLogLog precision: 2^p one-byte registers, ~1.04/sqrt(2^p) error
+#define SKETCH_HLL_PRECISION 10
+
+#define BLOOM_BYTES (SKETCH_BLOOM_BITS / 8)
+#define HLL_REGISTERS (1 << SKETCH_HLL_PRECISION)
+
+// Bloom hash functions per key
+#define BLOOM_HASHES 4
+
+// Two independent hashes of a packed MAC; h2 is odd so the Bloom probes
+// (h1 + i * h2) never repeat a bit
+struct SketchHash {
+    uint64_t h1;
+    uint64_t h2;
+};
+
+inline uint64_t sketch_mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+inline SketchHash sketch_hash(uint64_t key) {
+    SketchHash h;
+    h.h1 = sketch_mix64(key);
+    h.h2 = sketch_mix64(key ^ 0x5bd1e9955bd1e995ULL) | 1;
+    return h;
+}
+
+// --- Bloom filter (one generation of BLOOM_BYTES) ---
+
+inline bool bloom_test(const uint8_t* bits, const SketchHash& h) {
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        uint32_t bit = (h.h1 + i * h.h2) % SKETCH_BLOOM_BITS;
+        if (!(bits[bit >> 3] & (1 << (bit & 7)))) return false;
+    }
+    return true;
+}
+
+inline void bloom_set(uint8_t* bits, const SketchHash& h) {
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        uint32_t bit = (h.h1 + i * h.h2) % SKETCH_BLOOM_BITS;
+        bits[bit >> 3] |= 1 << (bit & 7);
+    }
+}
+
+// --- HyperLogLog (HLL_REGISTERS one-byte registers) ---
+
+inline void hll_add(uint8_t* registers, uint64_t hash) {
+    uint32_t idx = hash >> (64 - SKETCH_HLL_PRECISION);
+    uint64_t rest = hash << SKETCH_HLL_PRECISION;
+
+    // Rank = position of the first set bit in the remaining bits
+    uint8_t rank = rest == 0 ? (64 - SKETCH_HLL_PRECISION + 1) : __builtin_clzll(rest) + 1;
+    if (rank > registers[idx]) registers[idx] = rank;
+}
+
+inline uint32_t hll_estimate(const uint8_t* registers) {
+    const double m = HLL_REGISTERS;
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double sum = 0;
+    int zeros = 0;
+
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -registers[i]);
+        if (registers[i] == 0) zeros++;
+    }
+
+    double estimate = alpha * m * m / sum;
+
+    // Linear counting is more accurate while many registers are empty
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * log(m / zeros);
+    }
+    return (uint32_t)(estimate + 0.5);
+}
@@ -0,0 +1,324 @@
+#include "device_store.h"
+#include <stdio.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+// Portable part of the store: file format, replay and compaction. Keep
+// this file free of Arduino headers so it can be exercised on a host.
+
+// Bumped with the StoredDevice layout; older files read as empty/torn
+const uint32_t STORE_MAGIC_LOG = 0x32474C44;   // "DLG2"
+const uint32_t STORE_MAGIC_CKPT = 0x324B4344;  // "DCK2"
+
+// Precedes every log batch and the checkpoint body
+struct StoreHeader {
+    uint32_t magic;
+    uint32_t seq;        // Batch number; for a checkpoint, the last batch it covers
+    uint32_t count;      // Records that follow
+    uint32_t crc;        // CRC-32 of those records
+    uint64_t clockMs;    // Store clock the record ages are relative to
+};
+
+static char ckptPath[64];
+static char ckptTmpPath[64];
+static char logPath[64];
+static char logOldPath[64];
+
+static bool opened = false;
+static uint32_t nextSeq = 1;
+static bool tornLog = false;
+
+// Compaction in progress
+static FILE* compactFile = nullptr;
+static StoreHeader compactHeader;
+
+static uint32_t crc32Update(uint32_t crc, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+bool store_init(const char* baseDir) {
+    snprintf(ckptPath, sizeof(ckptPath), "%s/ckpt.bin", baseDir);
+    snprintf(ckptTmpPath, sizeof(ckptTmpPath), "%s/ckpt.tmp", baseDir);
+    snprintf(logPath, sizeof(logPath), "%s/log.bin", baseDir);
+    snprintf(logOldPath, sizeof(logOldPath), "%s/log.old", baseDir);
+
+    // A half-written checkpoint from an interrupted compaction is useless
+    if (compactFile != nullptr) {
+        fclose(compactFile);
+        compactFile = nullptr;
+    }
+    remove(ckptTmpPath);
+
+    FILE* f = fopen(logPath, "ab");
+    if (f == nullptr) return false;
+    fclose(f);
+    opened = true;
+    return true;
+}
+
+bool store_isOpen() {
+    return opened;
+}
+
+// Devices being rebuilt during load, with absolute store-clock times
+struct LoadedDevice {
+    StoredDevice rec;
+    uint64_t firstAt;
+    uint64_t lastAt;
+};
+
+struct LoadState {
+    std::vector<LoadedDevice> devices;
+    std::unordered_map<uint64_t, size_t> index;
+    uint64_t clockMs = 0;
+    uint32_t coversSeq = 0;
+};
+
+static void applyRecord(LoadState& st, const StoredDevice& rec, uint64_t clockMs) {
+    auto it = st.index.find(rec.key);
+
+    if (rec.flags & STORE_FLAG_REMOVED) {
+        if (it != st.index.end()) {
+            st.devices[it->second].rec.flags |= STORE_FLAG_REMOVED;
+        }
+        return;
+    }
+
+    LoadedDevice loaded;
+    loaded.rec = rec;
+    loaded.firstAt = clockMs - rec.firstAge;
+    loaded.lastAt = clockMs - rec.lastAge;
+
+    if (it == st.index.end()) {
+        st.index[rec.key] = st.devices.size();
+        st.devices.push_back(loaded);
+    } else {
+        st.devices[it->second] = loaded;
+    }
+}
+
+// Read one header + records; false at end of file or on a bad block
+static bool readBlock(FILE* f, uint32_t magic, StoreHeader& header,
+                      std::vector<StoredDevice>& records) {
+    if (fread(&header, sizeof(header), 1, f) != 1) return false;
+    if (header.magic != magic || header.count > 100000) return false;
+
+    records.resize(header.count);
+    if (header.count > 0 &&
+        fread(records.data(), sizeof(StoredDevice), header.count, f) != header.count) {
+        return false;
+    }
+    return crc32Update(0, records.data(), header.count * sizeof(StoredDevice)) == header.crc;
+}
+
+// Replay one log file; returns false if it ended in a torn/corrupt batch
+static bool replayLog(LoadState& st, const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) return true;
+
+    StoreHeader header;
+    std::vector<StoredDevice> records;
+    bool clean = true;
+
+    for (;;) {
+        long start = ftell(f);
+        if (!readBlock(f, STORE_MAGIC_LOG, header, records)) {
+            // Anything left after the last good batch is a torn write
+            fseek(f, 0, SEEK_END);
+            clean = ftell(f) == start;
+            break;
+        }
+
+        if (header.seq >= nextSeq) nextSeq = header.seq + 1;
+        if (header.clockMs > st.clockMs) st.clockMs = header.clockMs;
+
+        // Already folded into the checkpoint
+        if (header.seq <= st.coversSeq) continue;
+
+        for (const auto& rec : records) {
+            applyRecord(st, rec, header.clockMs);
+        }
+    }
+
+    fclose(f);
+    return clean;
+}
+
+int store_load(StoredDevice* out, int maxCount, uint64_t* clockMs) {
+    LoadState st;
+    StoreHeader header;
+    std::vector<StoredDevice> records;
+
+    FILE* f = fopen(ckptPath, "rb");
+    if (f != nullptr) {
+        if (readBlock(f, STORE_MAGIC_CKPT, header, records)) {
+            st.coversSeq = header.seq;
+            st.clockMs = header.clockMs;
+            nextSeq = header.seq + 1;
+            for (const auto& rec : records) {
+                applyRecord(st, rec, header.clockMs);
+            }
+        }
+        fclose(f);
+    }
+
+    // log.old only exists if a compaction was interrupted
+    replayLog(st, logOldPath);
+    tornLog = !replayLog(st, logPath);
+
+    int count = 0;
+    for (const auto& dev : st.devices) {
+        if (count >= maxCount) break;
+        if (dev.rec.flags & STORE_FLAG_REMOVED) continue;
+
+        out[count] = dev.rec;
+        out[count].firstAge = (uint32_t)(st.clockMs - dev.firstAt);
+        out[count].lastAge = (uint32_t)(st.clockMs - dev.lastAt);
+        count++;
+    }
+
+    *clockMs = st.clockMs;
+    return count;
+}
+
+bool store_appendBatch(const StoredDevice* records, int count, uint64_t clockMs) {
+    if (count <= 0) return true;
+
+    StoreHeader header;
+    header.magic = STORE_MAGIC_LOG;
+    header.seq = nextSeq;
+    header.count = count;
+    header.crc = crc32Update(0, records, count * sizeof(StoredDevice));
+    header.clockMs = clockMs;
+
+    FILE* f = fopen(logPath, "ab");
+    if (f == nullptr) return false;
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(records, sizeof(StoredDevice), count, f) == (size_t)count;
+    ok = (fclose(f) == 0) && ok;
+
+    if (ok) nextSeq++;
+    return ok;
+}
+
+long store_logSize() {
+    FILE* f = fopen(logPath, "rb");
+    if (f == nullptr) return 0;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+bool store_needsCompaction() {
+    return tornLog;
+}
+
+bool store_compacting() {
+    return compactFile != nullptr;
+}
+
+// Copy the contents of src onto the end of dst
+static bool appendFile(const char* dst, const char* src) {
+    FILE* in = fopen(src, "rb");
+    if (in == nullptr) return true;
+    FILE* out = fopen(dst, "ab");
+    if (out == nullptr) {
+        fclose(in);
+        return false;
+    }
+
+    char buf[256];
+    size_t n;
+    bool ok = true;
+    while (ok && (n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        ok = fwrite(buf, 1, n, out) == n;
+    }
+    fclose(in);
+    return (fclose(out) == 0) && ok;
+}
+
+bool store_beginCompaction(uint64_t clockMs) {
+    if (compactFile != nullptr) return false;
+
+    // A previous compaction that never finished left log.old behind. Its
+    // batches are not in the checkpoint yet, so keep them and append the
+    // current log after them instead of replacing the file.
+    FILE* old = fopen(logOldPath, "rb");
+    if (old != nullptr) {
+        fclose(old);
+        if (!appendFile(logOldPath, logPath)) return false;
+        remove(logPath);
+    } else if (rename(logPath, logOldPath) != 0) {
+        return false;
+    }
+
+    FILE* f = fopen(logPath, "ab");
+    if (f == nullptr) return false;
+    fclose(f);
+
+    compactFile = fopen(ckptTmpPath, "wb");
+    if (compactFile == nullptr) return false;
+
+    // The checkpoint covers every batch written before the rotation
+    compactHeader.magic = STORE_MAGIC_CKPT;
+    compactHeader.seq = nextSeq - 1;
+    compactHeader.count = 0;
+    compactHeader.crc = 0;
+    compactHeader.clockMs = clockMs;
+
+    // Placeholder, rewritten once the count and CRC are known
+    if (fwrite(&compactHeader, sizeof(compactHeader), 1, compactFile) != 1) {
+        fclose(compactFile);
+        compactFile = nullptr;
+        return false;
+    }
+    tornLog = false;
+    return true;
+}
+
+bool store_compactWrite(const StoredDevice* records, int count) {
+    if (compactFile == nullptr) return false;
+    if (count <= 0) return true;
+
+    if (fwrite(records, sizeof(StoredDevice), count, compactFile) != (size_t)count) {
+        fclose(compactFile);
+        compactFile = nullptr;
+        remove(ckptTmpPath);
+        return false;
+    }
+
+    compactHeader.count += count;
+    compactHeader.crc = crc32Update(compactHeader.crc, records, count * sizeof(StoredDevice));
+    return true;
+}
+
+bool store_finishCompaction() {
+    if (compactFile == nullptr) return false;
+
+    bool ok = fseek(compactFile, 0, SEEK_SET) == 0 &&
+              fwrite(&compactHeader, sizeof(compactHeader), 1, compactFile) == 1;
+    ok = (fclose(compactFile) == 0) && ok;
+    compactFile = nullptr;
+
+    if (!ok) {
+        remove(ckptTmpPath);
+        return false;
+    }
+
+    // rename() replaces the old checkpoint atomically; log.old is only
+    // dropped once the new checkpoint (which covers it) is in place
+    if (rename(ckptTmpPath, ckptPath) != 0) return false;
+    remove(logOldPath);
+    return true;
+}
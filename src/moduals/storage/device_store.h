@@ -0,0 +1,99 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Log-structured persistent device store.
+//
+// The tracker table survives reboots as a checkpoint file plus an
+// append-only log of delta batches:
+//   ckpt.bin  - full table as of some batch sequence number
+//   log.bin   - batches appended since (changed devices + removals)
+//   log.old   - previous log while a compaction is in progress
+// Batches are written at most every STORE_FLUSH_INTERVAL to limit flash
+// wear. When the log grows past STORE_LOG_MAX it is compacted: the log is
+// rotated and a fresh checkpoint is written a few records per call from
+// store_service(), then swapped in atomically with rename().
+//
+// The file format code uses only stdio, so it runs unchanged against
+// LittleFS on the board (mounted at /littlefs) and against a plain
+// directory on a host.
+//
+// Times are stored as ages relative to a store clock that keeps counting
+// across reboots; downtime itself is not counted, so a warm restart looks
+// like the scan loop simply paused.
+
+#define STORE_NAME_LEN 31
+
+// Minimum time between delta batches (ms)
+#ifndef STORE_FLUSH_INTERVAL
+#define STORE_FLUSH_INTERVAL 60000
+#endif
+
+// Log size that triggers compaction (bytes); also bounds restore time
+#ifndef STORE_LOG_MAX
+#define STORE_LOG_MAX (64 * 1024)
+#endif
+
+// Fixed-size record for one device (also used for removals)
+struct StoredDevice {
+    uint64_t key;          // Packed MAC identity
+    uint64_t addrKey;      // Current address, differs after BLE rotation
+    uint32_t fingerprint;  // BLE advertisement fingerprint, 0 if none
+    uint32_t firstAge;     // ms before the enclosing batch/checkpoint clock
+    uint32_t lastAge;
+    uint32_t seenCount;
+    float avgRSSI;
+    int8_t rssi;
+    uint8_t type;          // DeviceType
+    uint8_t channel;
+    uint8_t vendor;        // Vendor
+    uint8_t flags;         // STORE_FLAG_*
+    uint8_t addrType;      // BLE address type, needed to connect
+    uint16_t addressCount;
+    char name[STORE_NAME_LEN + 1];
+};
+
+#define STORE_FLAG_REMOVED 0x01
+
+// --- Portable core (stdio only, see device_store.cpp) ---
+
+// Open the store in baseDir (e.g. "/littlefs"); false if it is unusable
+bool store_init(const char* baseDir);
+
+// True once store_init succeeded
+bool store_isOpen();
+
+// Replay checkpoint + log into `out` (at most maxCount devices, removals
+// already applied). Ages in the output are relative to *clockMs, the
+// newest store clock found on disk. Returns the number of devices.
+int store_load(StoredDevice* out, int maxCount, uint64_t* clockMs);
+
+// Append one batch of records with ages relative to clockMs
+bool store_appendBatch(const StoredDevice* records, int count, uint64_t clockMs);
+
+// Bytes currently in the active log
+long store_logSize();
+
+// True if the log had a torn or corrupt tail on load
+bool store_needsCompaction();
+
+// Compaction: rotate the log, stream the full table into a temporary
+// checkpoint in chunks, then atomically replace the old checkpoint
+bool store_beginCompaction(uint64_t clockMs);
+bool store_compactWrite(const StoredDevice* records, int count);
+bool store_finishCompaction();
+bool store_compacting();
+
+// --- Tracker glue (device only, see device_store_sync.cpp) ---
+
+// Restore the tracker table from the store (call after tracking_init)
+int store_restore();
+
+// Flush due deltas and advance any compaction. Call from loop().
+void store_service();
+
+// Write pending deltas now (e.g. before a planned restart)
+void store_flush();
+
+// Print file sizes and counters
+void store_printStats();
@@ -0,0 +1,240 @@
+#include "device_store.h"
+#include <Arduino.h>
+#include <vector>
+#include <algorithm>
+#include "../tracking/tracking.h"
+#include "../events/events.h"
+#include "../utils/mac_key.h"
+
+// Records written to the checkpoint per store_service() call, so a
+// compaction never stalls the scan loop for long
+const int COMPACT_CHUNK = 32;
+
+// A compaction that fails to start is retried after a growing delay
+const unsigned long COMPACT_RETRY_MIN = 5000;            // 5 Seconds
+const unsigned long COMPACT_RETRY_MAX = 10 * 60 * 1000;  // 10 Minutes
+static unsigned long compactRetryMs = 0;    // 0 = last start succeeded
+static unsigned long compactFailedAt = 0;
+
+// Tombstones were lost, so only a full checkpoint is consistent
+static bool checkpointNeeded = false;
+
+static uint64_t clockBase = 0;      // Store clock when this boot started
+static unsigned long lastFlush = 0;
+static int storeEvents = -1;
+
+// Removals seen since the last flush
+static std::vector<uint64_t> pendingRemovals;
+
+// Table snapshot being streamed into a new checkpoint
+static std::vector<StoredDevice> compactSnapshot;
+static size_t compactPos = 0;
+
+static uint32_t batchesWritten = 0;
+static uint32_t compactions = 0;
+static int restoredDevices = 0;
+
+static uint64_t storeClock() {
+    return clockBase + millis();
+}
+
+static void toStored(const TrackedDevice& dev, unsigned long now, StoredDevice& out) {
+    memset(&out, 0, sizeof(out));
+    out.key = dev.key;
+    out.addrKey = dev.addrKey;
+    out.fingerprint = dev.fingerprint;
+    out.addrType = dev.addrType;
+    out.addressCount = dev.addressCount;
+    out.firstAge = now - dev.firstSeen;
+    out.lastAge = now - dev.lastSeen;
+    out.seenCount = dev.seenCount;
+    out.avgRSSI = dev.avgRSSI;
+    out.rssi = dev.rssi;
+    out.type = dev.type;
+    out.channel = dev.channel;
+    out.vendor = dev.vendor;
+    strncpy(out.name, dev.name.c_str(), STORE_NAME_LEN);
+}
+
+int store_restore() {
+    if (!store_isOpen()) return 0;
+
+    // Subscribe before restoring so no removal goes unseen
+    storeEvents = events_subscribe("store");
+    if (storeEvents < 0) {
+        Serial.println("Device store: no event feed, writing checkpoints only");
+    }
+
+    std::vector<StoredDevice> loaded(tracking_capacity());
+    unsigned long start = millis();
+    int count = store_load(loaded.data(), loaded.size(), &clockBase);
+
+    // Continue the clock where the last boot left it
+    clockBase -= millis();
+    unsigned long now = millis();
+
+    for (int i = 0; i < count; i++) {
+        const StoredDevice& rec = loaded[i];
+
+        uint64_t addrKey = rec.addrKey != 0 ? rec.addrKey : rec.key;
+        char mac[18];
+        mac_format(addrKey, mac);
+        
+        TrackedDevice dev;
+        dev.key = rec.key;
+        dev.addrKey = addrKey;
+        dev.mac = mac;
+        dev.fingerprint = rec.fingerprint;
+        dev.addressCount = rec.addressCount > 0 ? rec.addressCount : 1;
+        dev.name = rec.name;
+        dev.rssi = rec.rssi;
+        dev.avgRSSI = rec.avgRSSI;
+        dev.distance = -1;  // Unknown until the next sighting
+        dev.type = (DeviceType)rec.type;
+        dev.channel = rec.channel;
+        dev.vendor = (Vendor)rec.vendor;
+        dev.firstSeen = now - rec.firstAge;
+        // Give every restored device a full timeout window to be re-sighted
+        dev.lastSeen = now;
+        dev.seenCount = rec.seenCount;
+        dev.isNew = false;
+        dev.isNear = false;
+        dev.isReturning = true;
+        dev.addrType = rec.addrType;
+        dev.battery = -1;
+        tracking_restore(dev);
+    }
+
+    restoredDevices = count;
+    lastFlush = millis();
+    Serial.printf("Device store: restored %d devices in %lu ms\n", count, millis() - start);
+
+    // A torn tail is skipped on replay; rewrite the files without it
+    if (store_needsCompaction()) {
+        Serial.println("Device store: log tail damaged, compacting");
+    }
+    return count;
+}
+
+// Take a snapshot of the table and open a new checkpoint
+static void beginCompaction() {
+    unsigned long now = millis();
+    if (compactRetryMs > 0 && now - compactFailedAt < compactRetryMs) return;
+    
+    const std::vector<TrackedDevice>& devices = tracking_view();
+
+    compactSnapshot.resize(devices.size());
+    for (size_t i = 0; i < devices.size(); i++) {
+        toStored(devices[i], now, compactSnapshot[i]);
+    }
+    compactPos = 0;
+
+    if (!store_beginCompaction(clockBase + now)) {
+        compactRetryMs = compactRetryMs == 0 ? COMPACT_RETRY_MIN :
+                         (std::min)(compactRetryMs * 2, COMPACT_RETRY_MAX);
+        compactFailedAt = now;
+        Serial.printf("Device store: compaction failed to start, retry in %lu s\n",
+                      compactRetryMs / 1000);
+        compactSnapshot.clear();
+        return;
+    }
+    compactRetryMs = 0;
+    checkpointNeeded = false;
+    
+    // Pending removals are for devices already missing from the snapshot
+    pendingRemovals.clear();
+}
+
+static void continueCompaction() {
+    int chunk = (std::min)((size_t)COMPACT_CHUNK, compactSnapshot.size() - compactPos);
+    bool ok = store_compactWrite(compactSnapshot.data() + compactPos, chunk);
+    compactPos += chunk;
+
+    if (ok && compactPos >= compactSnapshot.size()) {
+        ok = store_finishCompaction();
+        if (ok) compactions++;
+    }
+    if (!ok || !store_compacting()) {
+        if (!ok) Serial.println("Device store: compaction failed");
+        compactSnapshot.clear();
+        compactSnapshot.shrink_to_fit();
+    }
+}
+
+void store_flush() {
+    if (!store_isOpen()) return;
+
+    unsigned long now = millis();
+    std::vector<StoredDevice> batch;
+
+    // Devices touched since the last flush
+    for (const auto& dev : tracking_view()) {
+        if ((long)(dev.lastSeen - lastFlush) > 0) {
+            batch.emplace_back();
+            toStored(dev, now, batch.back());
+        }
+    }
+
+    for (uint64_t key : pendingRemovals) {
+        batch.emplace_back();
+        memset(&batch.back(), 0, sizeof(StoredDevice));
+        batch.back().key = key;
+        batch.back().flags = STORE_FLAG_REMOVED;
+    }
+
+    if (store_appendBatch(batch.data(), batch.size(), clockBase + now)) {
+        if (!batch.empty()) batchesWritten++;
+        pendingRemovals.clear();
+        lastFlush = now;
+    } else {
+        Serial.println("Device store: write failed");
+    }
+}
+
+void store_service() {
+    if (!store_isOpen()) return;
+
+    // Collect removals as tombstones for the next batch
+    TrackingEvent ev;
+    while (events_poll(storeEvents, ev)) {
+        if (ev.type == EVENT_LOST) pendingRemovals.push_back(ev.key);
+    }
+
+    // Lost tombstones: force a full checkpoint to stay consistent
+    if (events_takeDropped(storeEvents) > 0) {
+        checkpointNeeded = true;
+    }
+
+    if (store_compacting()) {
+        continueCompaction();
+        return;
+    }
+
+    // Never append behind a damaged tail; replay would stop before it
+    if (checkpointNeeded || store_needsCompaction()) {
+        beginCompaction();
+        return;
+    }
+
+    if (millis() - lastFlush >= STORE_FLUSH_INTERVAL) {
+        // Without tombstones a delta batch cannot record removals
+        if (storeEvents < 0) {
+            lastFlush = millis();
+            beginCompaction();
+            return;
+        }
+        store_flush();
+        if (store_logSize() > STORE_LOG_MAX) {
+            beginCompaction();
+        }
+    }
+}
+
+void store_printStats() {
+    Serial.println("\n=== Device Store ===");
+    Serial.printf("Restored at boot: %d\n", restoredDevices);
+    Serial.printf("Log size: %ld bytes (compacts at %d)\n", store_logSize(), STORE_LOG_MAX);
+    Serial.printf("Batches written: %u, compactions: %u\n", batchesWritten, compactions);
+    Serial.printf("Store clock: %llu s\n", storeClock() / 1000);
+    Serial.println("====================\n");
+}
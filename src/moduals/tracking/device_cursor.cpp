@@ -0,0 +1,178 @@
+#include "device_cursor.h"
+#include "query.h"
+#include <algorithm>
+
+// Closest first; devices with no distance yet go last rather than first
+struct OrderByKnownDistance {
+    static const bool sorted = true;
+    bool operator()(const TrackedDevice& a, const TrackedDevice& b) const {
+        bool aKnown = a.distance >= 0;
+        bool bKnown = b.distance >= 0;
+        if (aKnown != bKnown) return aKnown;
+        return a.distance < b.distance;
+    }
+};
+
+// Make an ordering strict and total by breaking ties on the packed MAC
+template <class Order>
+struct ThenByKey {
+    static const bool sorted = true;
+    Order order;
+    bool operator()(const TrackedDevice& a, const TrackedDevice& b) const {
+        if (order(a, b)) return true;
+        if (order(b, a)) return false;
+        return a.key < b.key;
+    }
+};
+
+template <class Order>
+struct Reversed {
+    static const bool sorted = true;
+    Order order;
+    explicit Reversed(const Order& order) : order(order) {}
+    bool operator()(const TrackedDevice& a, const TrackedDevice& b) const { return order(b, a); }
+};
+
+// Devices strictly before / after an anchor device in an ordering
+template <class Order>
+struct Before : Predicate<Before<Order>> {
+    const TrackedDevice* anchor;
+    Order order;
+    Before(const TrackedDevice* anchor, const Order& order) : anchor(anchor), order(order) {}
+    bool operator()(const TrackedDevice& dev) const { return order(dev, *anchor); }
+};
+
+template <class Order>
+struct After : Predicate<After<Order>> {
+    const TrackedDevice* anchor;
+    Order order;
+    After(const TrackedDevice* anchor, const Order& order) : anchor(anchor), order(order) {}
+    bool operator()(const TrackedDevice& dev) const { return order(*anchor, dev); }
+};
+
+static CursorOrder currentOrder = CURSOR_BY_DISTANCE;
+static uint64_t selectedKey = 0;
+static CursorPage page = {};
+static uint32_t pageVersion = 0;
+static bool pageStale = true;       // Order or selection replaced; rebuild now
+static bool pageMoved = false;      // Selection moved along the page; rebuild when idle
+
+template <class Order>
+static void buildPage(const Order& order) {
+    const TrackedDevice* anchor = tracking_getDeviceByKey(selectedKey);
+
+    // Selection evicted: hand it to the row that followed it, else the one before
+    for (int i = page.selectedRow + 1; anchor == nullptr && i < page.count; i++) {
+        anchor = tracking_getDeviceByKey(page.keys[i]);
+    }
+    for (int i = page.selectedRow - 1; anchor == nullptr && i >= 0; i--) {
+        anchor = tracking_getDeviceByKey(page.keys[i]);
+    }
+    if (anchor == nullptr) {
+        auto first = tracking_query<1>(AnyDevice(), order);
+        anchor = first.empty() ? nullptr : &first[0];
+    }
+
+    page.count = 0;
+    page.selectedRow = -1;
+    page.firstRank = 0;
+    page.total = 0;
+    selectedKey = anchor != nullptr ? anchor->key : 0;
+    if (anchor == nullptr) return;
+
+    // Nearest neighbours on each side, closest to the selection first
+    auto before = tracking_query<CURSOR_PAGE_ROWS - 1>(Before<Order>(anchor, order),
+                                                      Reversed<Order>(order));
+    auto after = tracking_query<CURSOR_PAGE_ROWS - 1>(After<Order>(anchor, order), order);
+
+    // Keep the selection on the middle row unless near an end. Either
+    // neighbour, when it exists, is always on the page.
+    int wantBefore = (std::max)(CURSOR_PAGE_ROWS / 2, CURSOR_PAGE_ROWS - 1 - after.count);
+    int nBefore = (std::min)(before.count, wantBefore);
+    int nAfter = (std::min)(after.count, CURSOR_PAGE_ROWS - 1 - nBefore);
+
+    for (int i = nBefore - 1; i >= 0; i--) {
+        page.keys[page.count++] = before[i].key;
+    }
+    page.selectedRow = page.count;
+    page.keys[page.count++] = anchor->key;
+    for (int i = 0; i < nAfter; i++) {
+        page.keys[page.count++] = after[i].key;
+    }
+
+    page.firstRank = before.matched - nBefore;
+    page.total = before.matched + 1 + after.matched;
+}
+
+void cursor_setOrder(CursorOrder order) {
+    if (order >= CURSOR_ORDER_COUNT || order == currentOrder) return;
+    currentOrder = order;
+    pageStale = true;
+}
+
+CursorOrder cursor_order() {
+    return currentOrder;
+}
+
+const char* cursor_orderName(CursorOrder order) {
+    switch (order) {
+        case CURSOR_BY_DISTANCE: return "dist";
+        case CURSOR_BY_RSSI:     return "rssi";
+        case CURSOR_BY_AGE:      return "age";
+        case CURSOR_BY_NAME:     return "name";
+        default:                 return "?";
+    }
+}
+
+void cursor_select(uint64_t key) {
+    selectedKey = key;
+    page.count = 0;     // Old neighbours say nothing about the new selection
+    page.selectedRow = -1;
+    pageStale = true;
+}
+
+uint64_t cursor_selectedKey() {
+    return selectedKey;
+}
+
+const CursorPage& cursor_page() {
+    if (!pageStale && !pageMoved && pageVersion == tracking_version()) return page;
+
+    // The table holds a partly applied round until tracking_step() finishes
+    // it; keep the page from the last completed one rather than rebuild
+    // against it (the version only moves when a round completes)
+    if (!pageStale && tracking_roundInProgress()) return page;
+
+    switch (currentOrder) {
+        case CURSOR_BY_RSSI: buildPage(ThenByKey<OrderByRSSI>()); break;
+        case CURSOR_BY_AGE:  buildPage(ThenByKey<OrderByAge>()); break;
+        case CURSOR_BY_NAME: buildPage(ThenByKey<OrderByName>()); break;
+        default:             buildPage(ThenByKey<OrderByKnownDistance>()); break;
+    }
+    pageVersion = tracking_version();
+    pageStale = false;
+    pageMoved = false;
+    return page;
+}
+
+// The page always holds the selection's neighbours, so moving is O(1)
+void cursor_next() {
+    cursor_page();
+    if (page.selectedRow >= 0 && page.selectedRow + 1 < page.count) {
+        selectedKey = page.keys[++page.selectedRow];
+        pageMoved = true;
+    }
+}
+
+void cursor_prev() {
+    cursor_page();
+    if (page.selectedRow > 0) {
+        selectedKey = page.keys[--page.selectedRow];
+        pageMoved = true;
+    }
+}
+
+const TrackedDevice* cursor_selected() {
+    cursor_page();
+    return selectedKey != 0 ? tracking_getDeviceByKey(selectedKey) : nullptr;
+}
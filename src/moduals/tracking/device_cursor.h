@@ -0,0 +1,60 @@
+#pragma once
+#include "tracking.h"
+
+// Paged cursor over the device table for the list and detail views.
+//
+// Devices are ordered by a selectable key (distance, RSSI, age or name)
+// with the packed MAC breaking ties, so the order never depends on where
+// a device sits in the table. The selection is held as a MAC key and stays
+// on the same device while others are inserted, evicted or reordered; if
+// the selected device itself is evicted, the neighbour that followed it
+// takes over.
+//
+// The visible page is found with keyset queries (see query.h) that keep
+// only the rows either side of the selection. It is rebuilt at most once
+// per completed tracking round (tracking_version()), and when the order or
+// selection changes; while a round is being applied, moving the selection
+// walks the existing page. An unchanged frame costs just the O(1) key
+// lookups of its rows.
+//
+//   const CursorPage& page = cursor_page();
+//   for (int i = 0; i < page.count; i++) {
+//       const TrackedDevice* dev = tracking_getDeviceByKey(page.keys[i]);
+//       ...
+//   }
+
+#define CURSOR_PAGE_ROWS 5
+
+enum CursorOrder : uint8_t {
+    CURSOR_BY_DISTANCE,     // Closest first, unknown distances last
+    CURSOR_BY_RSSI,         // Strongest first
+    CURSOR_BY_AGE,          // Most recently seen first
+    CURSOR_BY_NAME,
+    CURSOR_ORDER_COUNT
+};
+
+struct CursorPage {
+    uint64_t keys[CURSOR_PAGE_ROWS];   // Visible rows, in order
+    int count;
+    int selectedRow;    // Row holding the selection, -1 if the table is empty
+    int firstRank;      // Position of the first row in the whole ordering
+    int total;          // Devices in the ordering
+};
+
+void cursor_setOrder(CursorOrder order);
+CursorOrder cursor_order();
+const char* cursor_orderName(CursorOrder order);
+
+// Select a device by packed MAC; an unknown key falls back to the first row
+void cursor_select(uint64_t key);
+uint64_t cursor_selectedKey();
+
+// Move the selection one device along the ordering (stops at the ends)
+void cursor_next();
+void cursor_prev();
+
+// The page around the selection, rebuilt only if something changed
+const CursorPage& cursor_page();
+
+// The selected device, or nullptr if the table is empty
+const TrackedDevice* cursor_selected();
@@ -0,0 +1,234 @@
+#pragma once
+#include <string.h>
+#include "tracking.h"
+
+// Composable queries over the tracked device table.
+//
+// Filters are small predicate structs combined with &&, || and ! at compile
+// time, so a whole query inlines into one loop over tracking_view() with no
+// virtual calls or intermediate vectors. Results are fixed-capacity spans of
+// table indices, valid until the next tracking_update() or tracking_step().
+//
+//   auto close = tracking_query<5>(ByType(TYPE_BLUETOOTH) && DistanceRange(0, 3),
+//                                  OrderByDistance());
+//   for (const TrackedDevice& dev : close) { ... }
+
+// Base for all predicates; only used to opt types into the operators below
+template <class Derived>
+struct Predicate {
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+};
+
+template <class A, class B>
+struct AndPredicate : Predicate<AndPredicate<A, B>> {
+    A a;
+    B b;
+    AndPredicate(const A& a, const B& b) : a(a), b(b) {}
+    bool operator()(const TrackedDevice& dev) const { return a(dev) && b(dev); }
+};
+
+template <class A, class B>
+struct OrPredicate : Predicate<OrPredicate<A, B>> {
+    A a;
+    B b;
+    OrPredicate(const A& a, const B& b) : a(a), b(b) {}
+    bool operator()(const TrackedDevice& dev) const { return a(dev) || b(dev); }
+};
+
+template <class A>
+struct NotPredicate : Predicate<NotPredicate<A>> {
+    A a;
+    explicit NotPredicate(const A& a) : a(a) {}
+    bool operator()(const TrackedDevice& dev) const { return !a(dev); }
+};
+
+template <class A, class B>
+AndPredicate<A, B> operator&&(const Predicate<A>& a, const Predicate<B>& b) {
+    return AndPredicate<A, B>(a.self(), b.self());
+}
+
+template <class A, class B>
+OrPredicate<A, B> operator||(const Predicate<A>& a, const Predicate<B>& b) {
+    return OrPredicate<A, B>(a.self(), b.self());
+}
+
+template <class A>
+NotPredicate<A> operator!(const Predicate<A>& a) {
+    return NotPredicate<A>(a.self());
+}
+
+// --- Filters ---
+
+struct AnyDevice : Predicate<AnyDevice> {
+    bool operator()(const TrackedDevice&) const { return true; }
+};
+
+struct ByType : Predicate<ByType> {
+    DeviceType type;
+    explicit ByType(DeviceType type) : type(type) {}
+    bool operator()(const TrackedDevice& dev) const { return dev.type == type; }
+};
+
+// Inclusive RSSI range in dBm
+struct RSSIRange : Predicate<RSSIRange> {
+    int lo, hi;
+    RSSIRange(int lo, int hi) : lo(lo), hi(hi) {}
+    bool operator()(const TrackedDevice& dev) const { return dev.rssi >= lo && dev.rssi <= hi; }
+};
+
+// Inclusive distance range in meters; unknown (-1) distances never match
+struct DistanceRange : Predicate<DistanceRange> {
+    float lo, hi;
+    DistanceRange(float lo, float hi) : lo(lo), hi(hi) {}
+    bool operator()(const TrackedDevice& dev) const {
+        return dev.distance >= 0 && dev.distance >= lo && dev.distance <= hi;
+    }
+};
+
+struct ByVendor : Predicate<ByVendor> {
+    Vendor vendor;
+    explicit ByVendor(Vendor vendor) : vendor(vendor) {}
+    bool operator()(const TrackedDevice& dev) const { return dev.vendor == vendor; }
+};
+
+// Case-sensitive name/SSID prefix. The prefix string must outlive the query.
+struct NamePrefix : Predicate<NamePrefix> {
+    const char* prefix;
+    size_t len;
+    explicit NamePrefix(const char* prefix) : prefix(prefix), len(strlen(prefix)) {}
+    bool operator()(const TrackedDevice& dev) const {
+        return strncmp(dev.name.c_str(), prefix, len) == 0;
+    }
+};
+
+// Seen within the last maxAgeMs milliseconds
+struct SeenWithin : Predicate<SeenWithin> {
+    unsigned long now, maxAge;
+    explicit SeenWithin(unsigned long maxAgeMs) : now(millis()), maxAge(maxAgeMs) {}
+    bool operator()(const TrackedDevice& dev) const { return now - dev.lastSeen <= maxAge; }
+};
+
+struct MinSeenCount : Predicate<MinSeenCount> {
+    int count;
+    explicit MinSeenCount(int count) : count(count) {}
+    bool operator()(const TrackedDevice& dev) const { return dev.seenCount >= count; }
+};
+
+// --- Orderings (strict "a comes before b") ---
+
+struct Unordered {
+    static const bool sorted = false;
+    bool operator()(const TrackedDevice&, const TrackedDevice&) const { return false; }
+};
+
+struct OrderByDistance {
+    static const bool sorted = true;
+    bool operator()(const TrackedDevice& a, const TrackedDevice& b) const { return a.distance < b.distance; }
+};
+
+struct OrderByRSSI {
+    static const bool sorted = true;
+    bool operator()(const TrackedDevice& a, const TrackedDevice& b) const { return a.rssi > b.rssi; }
+};
+
+// Most recently seen first
+struct OrderByAge {
+    static const bool sorted = true;
+    bool operator()(const TrackedDevice& a, const TrackedDevice& b) const { return a.lastSeen > b.lastSeen; }
+};
+
+struct OrderByName {
+    static const bool sorted = true;
+    bool operator()(const TrackedDevice& a, const TrackedDevice& b) const {
+        return strcmp(a.name.c_str(), b.name.c_str()) < 0;
+    }
+};
+
+// --- Results ---
+
+// Up to LIMIT indices into the device table, in query order
+template <int LIMIT>
+struct DeviceSpan {
+    const TrackedDevice* table;
+    uint16_t index[LIMIT];
+    int count;      // Entries held in this span
+    int matched;    // Total matches, may exceed LIMIT
+
+    class iterator {
+    public:
+        iterator(const TrackedDevice* table, const uint16_t* pos) : table(table), pos(pos) {}
+        const TrackedDevice& operator*() const { return table[*pos]; }
+        const TrackedDevice* operator->() const { return &table[*pos]; }
+        iterator& operator++() { pos++; return *this; }
+        bool operator!=(const iterator& other) const { return pos != other.pos; }
+    private:
+        const TrackedDevice* table;
+        const uint16_t* pos;
+    };
+
+    iterator begin() const { return iterator(table, index); }
+    iterator end() const { return iterator(table, index + count); }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    const TrackedDevice& operator[](int i) const { return table[index[i]]; }
+};
+
+// Run a query over the live table. With an ordering, the span holds the
+// first LIMIT devices in that order (a bounded insertion sort maintained
+// during the single scan); without one, the first LIMIT matches.
+template <int LIMIT, class Pred, class Order = Unordered>
+DeviceSpan<LIMIT> tracking_query(const Pred& pred, const Order& order = Order()) {
+    const std::vector<TrackedDevice>& devices = tracking_view();
+    DeviceSpan<LIMIT> result;
+    result.table = devices.data();
+    result.count = 0;
+    result.matched = 0;
+
+    for (size_t i = 0; i < devices.size(); i++) {
+        const TrackedDevice& dev = devices[i];
+        if (!pred(dev)) continue;
+        result.matched++;
+
+        if (!Order::sorted) {
+            if (result.count < LIMIT) result.index[result.count++] = i;
+            continue;
+        }
+
+        // Skip devices that would fall past the end of a full span
+        int pos = result.count;
+        if (pos == LIMIT && !order(dev, devices[result.index[LIMIT - 1]])) continue;
+        if (pos == LIMIT) pos--;
+
+        while (pos > 0 && order(dev, devices[result.index[pos - 1]])) {
+            result.index[pos] = result.index[pos - 1];
+            pos--;
+        }
+        result.index[pos] = i;
+        if (result.count < LIMIT) result.count++;
+    }
+
+    return result;
+}
+
+// Count matches without collecting them
+template <class Pred>
+int tracking_count(const Pred& pred) {
+    int count = 0;
+    for (const auto& dev : tracking_view()) {
+        if (pred(dev)) count++;
+    }
+    return count;
+}
+
+// Call fn(dev) for every match, in table order
+template <class Pred, class Fn>
+int tracking_forEach(const Pred& pred, Fn fn) {
+    int count = 0;
+    for (const auto& dev : tracking_view()) {
+        if (pred(dev)) {
+            fn(dev);
+            count++;
+        }
+    }
+    return count;
+}
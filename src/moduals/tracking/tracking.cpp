@@ -1,210 +1,809 @@
 #include "tracking.h"
+#include "query.h"
 #include <algorithm>
+#include "../events/events.h"
+#include "../history/history.h"
+#include "../sketch/presence_sketch.h"
+#include "../utils/mac_key.h"
+#include "../utils/key_index.h"
+#include "../utils/rssi_kernels.h"
 
 // Storage for tracked devices
 static std::vector<TrackedDevice> trackedDevices;
 static unsigned long lastUpdateTime = 0;
+static unsigned long roundTime = 0;     // millis() of the round being ingested
+static uint32_t tableVersion = 0;       // Bumped on every change to the table
+
+// What readers see: the version and aggregates as of the last completed
+// round, so a round being applied a slice at a time never shows through
+static uint32_t publishedVersion = 0;
+static TrackingStats publishedStats;
+
+// Entries the table may hold; reserved up front so it never reallocates
+static size_t tableCapacity = MAX_TRACKED_DEVICES;
+
+// Round in progress for the budgeted path (see tracking_step())
+enum RoundState {
+    ROUND_IDLE,         // Nothing to do
+    ROUND_OPEN,         // Accepting results
+    ROUND_CLOSED        // Draining the queue, then sweeping for timeouts
+};
+static RoundState roundState = ROUND_IDLE;
+static std::vector<wifi_ap_record_t> pendingAPs;   // Submitted, not yet ingested
+static size_t pendingAPHead = 0;
+static std::vector<Device> pendingDevices;
+static size_t pendingHead = 0;
+static size_t sweepCursor = 0;
+
+// Devices flagged isNew by the current round, cleared by the next one
+static std::vector<uint64_t> newDeviceKeys;
+
+// O(1) lookups: MAC -> table index, BLE fingerprint -> table index.
+// Both are rebuilt whenever the table is compacted.
+static KeyIndex<MAX_TRACKED_DEVICES * 4> deviceIndex;
+static KeyIndex<MAX_TRACKED_DEVICES> fingerprintIndex;
+static uint32_t mergedAddresses = 0;
+static uint32_t droppedDevices = 0;
+static uint32_t returningDevices = 0;
+
+// Running aggregates (see TrackingStats). Every device in the table is
+// counted exactly once; a device with a queued sighting is taken out
+// when the sighting is recorded and put back when the batch is applied.
+static TrackingStats stats;
+static double distanceSum = 0;
+
+// Known distances by RSSI slot (-rssi). Distance only ever comes from
+// rssi_distance(rssi), which falls as RSSI rises, so the lowest occupied
+// slot is the closest device.
+const int DISTANCE_SLOTS = 128;
+static uint16_t distanceSlots[DISTANCE_SLOTS];
+static int nearestSlot = DISTANCE_SLOTS;
 
 // Timeout for removing inactive devices (milliseconds)
 const unsigned long DEVICE_TIMEOUT = 10000; // 10 Seconds
+static unsigned long deviceTimeout = DEVICE_TIMEOUT;
 
-void tracking_init() {
-    trackedDevices.clear();
-    Serial.println("Device tracking initialized");
+// Sightings of known devices are folded in this many at a time by the
+// batched kernels (see utils/rssi_kernels.h)
+const int SIGHTING_BATCH = 64;
+
+static uint16_t pendingIndex[SIGHTING_BATCH];
+static int8_t pendingRSSI[SIGHTING_BATCH];
+static float pendingSample[SIGHTING_BATCH];
+static float pendingWeight[SIGHTING_BATCH];
+static float pendingAvg[SIGHTING_BATCH];
+static float pendingScratch[SIGHTING_BATCH];
+static int pendingCount = 0;
+
+// Largest RSSI change accepted when matching a rotated BLE address
+const int ROTATION_MAX_RSSI_JUMP = 12; // dBm
+
+static void resetStats() {
+    memset(&stats, 0, sizeof(stats));
+    memset(distanceSlots, 0, sizeof(distanceSlots));
+    distanceSum = 0;
+    nearestSlot = DISTANCE_SLOTS;
 }
 
-// Find a device in the tracked list by MAC address
-int findDeviceIndex(const String& mac) {
+// Add (delta = 1) or remove (delta = -1) one device's contribution
+static void accountDevice(const TrackedDevice& dev, int delta) {
+    stats.total += delta;
+    stats.byType[dev.type] += delta;
+    stats.byChannel[dev.channel < TRACKING_CHANNEL_SLOTS ? dev.channel : 0] += delta;
+    stats.byProximity[getProximity(dev.distance)] += delta;
+    stats.byVendor[dev.vendor < VENDOR_COUNT ? dev.vendor : VENDOR_UNKNOWN] += delta;
+    
+    if (dev.distance < 0) return;
+    
+    int slot = dev.rssi >= 0 ? 0 : (dev.rssi < -127 ? 127 : -dev.rssi);
+    distanceSlots[slot] += delta;
+    stats.withDistance += delta;
+    distanceSum = stats.withDistance > 0 ? distanceSum + delta * dev.distance : 0;
+    
+    // The closest slot only moves outward when it empties
+    if (delta > 0 && slot < nearestSlot) {
+        nearestSlot = slot;
+    } else if (delta < 0 && slot == nearestSlot) {
+        while (nearestSlot < DISTANCE_SLOTS && distanceSlots[nearestSlot] == 0) {
+            nearestSlot++;
+        }
+    }
+}
+
+// Find a device in the tracked list by packed MAC (current or original)
+static int findDeviceIndex(uint64_t key) {
+    uint16_t idx = deviceIndex.find(key);
+    return idx == deviceIndex.NONE ? -1 : idx;
+}
+
+// Rebuild the lookup indices after the table has been compacted
+static void rebuildIndices() {
+    deviceIndex.clear();
+    fingerprintIndex.clear();
+    
     for (size_t i = 0; i < trackedDevices.size(); i++) {
-        if (trackedDevices[i].mac.equals(mac)) {
-            return i;
+        const TrackedDevice& dev = trackedDevices[i];
+        deviceIndex.insert(dev.key, i);
+        if (dev.addrKey != dev.key) {
+            deviceIndex.insert(dev.addrKey, i);
+        }
+        if (dev.fingerprint != 0) {
+            fingerprintIndex.insert(dev.fingerprint, i);
         }
     }
-    return -1;
 }
 
-void tracking_update(const std::vector<Device>& wifiDevices, 
-                     const std::vector<Device>& btDevices) {
+// A rotating BLE address we have not seen before may belong to a tracked
+// handset that just picked a new one. Returns its index, or -1.
+static int findRotatedDevice(const Device& dev, unsigned long currentTime) {
+    if (!dev.rotatingAddress || dev.fingerprint == 0) return -1;
     
-    unsigned long currentTime = millis();
+    uint16_t idx = fingerprintIndex.find(dev.fingerprint);
+    if (idx == fingerprintIndex.NONE) return -1;
     
-    // Mark all devices as not seen this cycle
-    for (auto& dev : trackedDevices) {
-        dev.isNew = false;
+    const TrackedDevice& candidate = trackedDevices[idx];
+    
+    // Seen in this same scan means two devices share the fingerprint
+    if (candidate.fingerprint != dev.fingerprint || candidate.lastSeen == currentTime) {
+        return -1;
     }
     
-    // Process WiFi devices
-    for (const auto& dev : wifiDevices) {
-        int idx = findDeviceIndex(dev.mac);
-        
+    // A handset does not jump across the room while rotating
+    if (abs(candidate.rssi - dev.rssi) > ROTATION_MAX_RSSI_JUMP) return -1;
+    
+    return idx;
+}
+
+// Move a tracked entity onto the address it rotated to
+static void rebindAddress(int idx, const Device& dev, uint64_t addrKey) {
+    TrackedDevice& tracked = trackedDevices[idx];
+    
+    if (tracked.addrKey != tracked.key) {
+        deviceIndex.erase(tracked.addrKey);
+    }
+    tracked.mac = dev.mac;
+    tracked.addrKey = addrKey;
+    tracked.addrType = dev.addrType;
+    tracked.addressCount++;
+    deviceIndex.insert(addrKey, idx);
+    mergedAddresses++;
+}
+
+// Publish NAME_CHANGED / APPROACH / DEPART for a sighting of a known device
+static void emitTransitions(TrackedDevice& tracked, int rssi, bool nameChanged) {
+    if (nameChanged) {
+        events_publish(EVENT_NAME_CHANGED, tracked.type, rssi, tracked.key);
+    }
+    
+    // Hysteresis keeps a device hovering at the threshold from flapping
+    if (!tracked.isNear && rssi >= events_getApproachThreshold()) {
+        tracked.isNear = true;
+        events_publish(EVENT_APPROACH, tracked.type, rssi, tracked.key);
+    } else if (tracked.isNear && rssi < events_getDepartThreshold()) {
+        tracked.isNear = false;
+        events_publish(EVENT_DEPART, tracked.type, rssi, tracked.key);
+    }
+}
+
+// Table entries that fit in the heap while leaving TRACKING_HEAP_RESERVE
+// for everything initialized later (store restore, history, GATT)
+static size_t capacityFromHeap() {
+#if defined(ARDUINO)
+    size_t freeHeap = ESP.getFreeHeap();
+    if (freeHeap <= TRACKING_HEAP_RESERVE) return TRACKING_MIN_DEVICES;
+    
+    size_t usable = (std::min)((size_t)ESP.getMaxAllocHeap(), freeHeap - TRACKING_HEAP_RESERVE);
+    size_t fit = usable / sizeof(TrackedDevice);
+    return (std::max)((size_t)TRACKING_MIN_DEVICES, (std::min)(fit, (size_t)MAX_TRACKED_DEVICES));
+#else
+    return MAX_TRACKED_DEVICES;
+#endif
+}
+
+// Make the current state what readers see
+static void publish() {
+    publishedVersion = tableVersion;
+    publishedStats = stats;
+    publishedStats.minDistance = nearestSlot < DISTANCE_SLOTS ? rssi_distance(-nearestSlot) : -1;
+    publishedStats.meanDistance = stats.withDistance > 0 ? distanceSum / stats.withDistance : -1;
+    publishedStats.merged = mergedAddresses;
+    publishedStats.returning = returningDevices;
+    publishedStats.dropped = droppedDevices;
+}
+
+void tracking_init() {
+    // Release any earlier reservation before sizing a new one
+    std::vector<TrackedDevice>().swap(trackedDevices);
+    tableCapacity = capacityFromHeap();
+    trackedDevices.reserve(tableCapacity);
+    rebuildIndices();
+    resetStats();
+    roundState = ROUND_IDLE;
+    publish();
+    Serial.printf("Device tracking initialized (%u devices, %u bytes)\n",
+                  (unsigned)tableCapacity, (unsigned)(tableCapacity * sizeof(TrackedDevice)));
+}
+
+// Create a table entry for a device seen for the first time
+static void addDevice(const Device& dev, uint64_t key, unsigned long currentTime) {
+    if (trackedDevices.size() >= tableCapacity) {
+        droppedDevices++;
+        return;
+    }
+    
+    TrackedDevice newDevice;
+    newDevice.mac = dev.mac;
+    newDevice.key = key;
+    newDevice.addrKey = key;
+    newDevice.name = dev.name;
+    newDevice.rssi = dev.rssi;
+    newDevice.avgRSSI = dev.rssi;
+    newDevice.distance = dev.distance;
+    newDevice.type = dev.type;
+    newDevice.vendor = dev.vendor;
+    newDevice.channel = dev.channel;
+    newDevice.fingerprint = dev.rotatingAddress ? dev.fingerprint : 0;
+    newDevice.addressCount = 1;
+    newDevice.lastSeen = currentTime;
+    newDevice.firstSeen = currentTime;
+    newDevice.seenCount = 1;
+    newDevice.isNew = true;
+    newDevice.isNear = dev.rssi >= events_getApproachThreshold();
+    newDevice.addrType = dev.addrType;
+    newDevice.battery = -1;
+    newDeviceKeys.push_back(key);
+    
+    // Ask the long-horizon sketch before this sighting lands in it
+    newDevice.isReturning = sketch_seenRecently(key);
+    if (newDevice.isReturning) {
+        returningDevices++;
+    }
+    
+    uint16_t idx = trackedDevices.size();
+    trackedDevices.push_back(newDevice);
+    accountDevice(newDevice, 1);
+    tableVersion++;
+    deviceIndex.insert(key, idx);
+    if (newDevice.fingerprint != 0) {
+        fingerprintIndex.insert(newDevice.fingerprint, idx);
+    }
+    
+    history_record(key, dev.rssi, currentTime);
+    sketch_record(key);
+    events_publish(EVENT_DISCOVERED, dev.type, dev.rssi, key);
+}
+
+bool tracking_restore(const TrackedDevice& device) {
+    if (trackedDevices.size() >= tableCapacity || findDeviceIndex(device.key) >= 0 ||
+        findDeviceIndex(device.addrKey) >= 0) {
+        return false;
+    }
+    
+    uint16_t idx = trackedDevices.size();
+    trackedDevices.push_back(device);
+    accountDevice(device, 1);
+    tableVersion++;
+    
+    // Same indices as a live device, so a restored handset can still
+    // absorb its next rotated address
+    deviceIndex.insert(device.key, idx);
+    if (device.addrKey != device.key) {
+        deviceIndex.insert(device.addrKey, idx);
+    }
+    if (device.fingerprint != 0) {
+        fingerprintIndex.insert(device.fingerprint, idx);
+    }
+    if (roundState == ROUND_IDLE) publish();
+    return true;
+}
+
+// Apply the queued sightings: smoothed RSSI and distance for the batch
+static void flushSightings() {
+    if (pendingCount == 0) return;
+    
+    for (int i = 0; i < pendingCount; i++) {
+        pendingAvg[i] = trackedDevices[pendingIndex[i]].avgRSSI;
+    }
+    rssi_smoothBatch(pendingAvg, pendingSample, pendingWeight, pendingScratch, pendingCount);
+    rssi_distanceBatch(pendingRSSI, pendingScratch, pendingCount);
+    
+    for (int i = 0; i < pendingCount; i++) {
+        TrackedDevice& tracked = trackedDevices[pendingIndex[i]];
+        tracked.avgRSSI = pendingAvg[i];
+        tracked.distance = pendingScratch[i];
+        accountDevice(tracked, 1);
+    }
+    pendingCount = 0;
+    tableVersion++;
+}
+
+// Fold the measurements of a sighting into an existing entry. The average
+// and distance are queued and updated by flushSightings().
+static void recordSighting(TrackedDevice& tracked, int rssi, uint8_t channel,
+                           unsigned long currentTime) {
+    uint16_t idx = &tracked - trackedDevices.data();
+    
+    // A second sighting in the same round must see the first one applied
+    if (tracked.lastSeen == currentTime) {
+        for (int i = 0; i < pendingCount; i++) {
+            if (pendingIndex[i] == idx) {
+                flushSightings();
+                break;
+            }
+        }
+    }
+    if (pendingCount == SIGHTING_BATCH) {
+        flushSightings();
+    }
+    
+    // Counted again, with the new channel and distance, on flush
+    accountDevice(tracked, -1);
+    tableVersion++;
+    tracked.rssi = rssi;
+    if (tracked.type != TYPE_BLUETOOTH) {
+        tracked.channel = channel;
+    }
+    tracked.lastSeen = currentTime;
+    tracked.seenCount++;
+    
+    // Running average for better distance estimation
+    pendingIndex[pendingCount] = idx;
+    pendingRSSI[pendingCount] = rssi;
+    pendingSample[pendingCount] = rssi;
+    pendingWeight[pendingCount] = 1.0f / tracked.seenCount;
+    pendingCount++;
+    
+    history_record(tracked.key, rssi, currentTime);
+    sketch_record(tracked.key);
+}
+
+// Fold a sighting into an existing entry
+static void updateDevice(TrackedDevice& tracked, const Device& dev, unsigned long currentTime) {
+    emitTransitions(tracked, dev.rssi, !tracked.name.equals(dev.name));
+    tracked.name = dev.name;  // Handle copy, no string work
+    recordSighting(tracked, dev.rssi, dev.channel, currentTime);
+}
+
+// Complete whatever round is in progress; an open one is closed first,
+// since it could never finish otherwise
+static void finishRound() {
+    tracking_closeRound();
+    while (!tracking_step(TRACKING_SLICE_US)) {
+        yield();
+    }
+}
+
+void tracking_beginRound() {
+    finishRound();
+    roundTime = millis();
+    roundState = ROUND_OPEN;
+    
+    // Only last round's discoveries carry the flag
+    for (uint64_t key : newDeviceKeys) {
+        int idx = findDeviceIndex(key);
         if (idx >= 0) {
-            // Update existing device
-            TrackedDevice& tracked = trackedDevices[idx];
-            tracked.name = dev.name;
-            tracked.rssi = dev.rssi;
-            tracked.distance = dev.distance;
-            tracked.channel = dev.channel;
-            tracked.lastSeen = currentTime;
-            tracked.seenCount++;
-            
-            // Update average RSSI for better distance estimation
-            tracked.avgRSSI = (tracked.avgRSSI * (tracked.seenCount - 1) + dev.rssi) / tracked.seenCount;
-            
-        } else {
-            // New device found
-            TrackedDevice newDevice;
-            newDevice.mac = dev.mac;
-            newDevice.name = dev.name;
-            newDevice.rssi = dev.rssi;
-            newDevice.avgRSSI = dev.rssi;
-            newDevice.distance = dev.distance;
-            newDevice.type = dev.type;
-            newDevice.channel = dev.channel;
-            newDevice.lastSeen = currentTime;
-            newDevice.firstSeen = currentTime;
-            newDevice.seenCount = 1;
-            newDevice.isNew = true;
-            
-            trackedDevices.push_back(newDevice);
-            
-            Serial.printf("[NEW] %s | %s | %.1fm\n", 
-                         dev.type == TYPE_WIFI_AP ? "WiFi AP" : "WiFi",
-                         dev.name.isEmpty() ? dev.mac.c_str() : dev.name.c_str(),
-                         dev.distance);
+            trackedDevices[idx].isNew = false;
         }
     }
+    newDeviceKeys.clear();
+}
+
+static void ingestDevice(const Device& dev) {
+    uint64_t key = mac_toKey(dev.mac.c_str());
+    int idx = findDeviceIndex(key);
     
-    // Process Bluetooth devices
-    for (const auto& dev : btDevices) {
-        int idx = findDeviceIndex(dev.mac);
-        
+    // Unknown rotating address: try to attach it to a tracked handset
+    if (idx < 0) {
+        idx = findRotatedDevice(dev, roundTime);
         if (idx >= 0) {
-            // Update existing device
-            TrackedDevice& tracked = trackedDevices[idx];
-            tracked.name = dev.name;
-            tracked.rssi = dev.rssi;
-            tracked.distance = dev.distance;
-            tracked.lastSeen = currentTime;
-            tracked.seenCount++;
-            tracked.avgRSSI = (tracked.avgRSSI * (tracked.seenCount - 1) + dev.rssi) / tracked.seenCount;
-            
-        } else {
-            // New device found
-            TrackedDevice newDevice;
-            newDevice.mac = dev.mac;
-            newDevice.name = dev.name;
-            newDevice.rssi = dev.rssi;
-            newDevice.avgRSSI = dev.rssi;
-            newDevice.distance = dev.distance;
-            newDevice.type = dev.type;
-            newDevice.channel = 0;
-            newDevice.lastSeen = currentTime;
-            newDevice.firstSeen = currentTime;
-            newDevice.seenCount = 1;
-            newDevice.isNew = true;
-            
-            trackedDevices.push_back(newDevice);
-            
-            Serial.printf("[NEW] BLE | %s | %.1fm\n", 
-                         dev.name.c_str(), dev.distance);
+            rebindAddress(idx, dev, key);
         }
     }
     
-    // Remove devices that haven't been seen recently
-    trackedDevices.erase(
-        std::remove_if(trackedDevices.begin(), trackedDevices.end(),
-            [currentTime](const TrackedDevice& dev) {
-                bool timeout = (currentTime - dev.lastSeen) > DEVICE_TIMEOUT;
-                if (timeout) {
-                    Serial.printf("[LOST] %s (%s)\n", 
-                                 dev.name.c_str(), dev.mac.c_str());
-                }
-                return timeout;
-            }),
-        trackedDevices.end()
-    );
+    if (idx >= 0) {
+        updateDevice(trackedDevices[idx], dev, roundTime);
+    } else {
+        addDevice(dev, key, roundTime);
+    }
+}
+
+void tracking_ingest(const std::vector<Device>& devices) {
+    for (const auto& dev : devices) {
+        ingestDevice(dev);
+    }
+}
+
+void tracking_submit(std::vector<Device>&& devices) {
+    if (pendingHead == pendingDevices.size()) {
+        pendingDevices.clear();
+        pendingHead = 0;
+    }
+    if (pendingDevices.empty()) {
+        pendingDevices.swap(devices);
+    } else {
+        for (auto& dev : devices) {
+            pendingDevices.push_back(std::move(dev));
+        }
+    }
+}
+
+static void ingestAP(const wifi_ap_record_t& record) {
+    uint64_t key = mac_fromBytes(record.bssid);
+    int idx = findDeviceIndex(key);
     
-    lastUpdateTime = currentTime;
+    // Only a new AP pays for a Device with String fields
+    if (idx < 0) {
+        addDevice(wifi_recordToDevice(record), key, roundTime);
+        return;
+    }
+    
+    TrackedDevice& tracked = trackedDevices[idx];
+    const char* ssid = (const char*)record.ssid;
+    bool renamed = strncmp(tracked.name.c_str(), ssid, sizeof(record.ssid)) != 0;
+    
+    emitTransitions(tracked, record.rssi, renamed);
+    if (renamed) {
+        tracked.name = ssid;
+    }
+    recordSighting(tracked, record.rssi, record.primary, roundTime);
+}
+
+void tracking_ingestWiFi(const wifi_ap_record_t& record) {
+    ingestAP(record);
+}
+
+void tracking_submitWiFi(const wifi_ap_record_t& record) {
+    if (pendingAPHead == pendingAPs.size()) {
+        pendingAPs.clear();
+        pendingAPHead = 0;
+    }
+    pendingAPs.push_back(record);
+}
+
+// Drop the device at idx by moving the last entry into its place, so the
+// table stays dense and only two entries' index slots change
+static void evictDevice(size_t idx) {
+    TrackedDevice& dev = trackedDevices[idx];
+    size_t last = trackedDevices.size() - 1;
+    
+    accountDevice(dev, -1);
+    events_publish(EVENT_LOST, dev.type, dev.rssi, dev.key);
+    
+    deviceIndex.erase(dev.key);
+    if (dev.addrKey != dev.key) {
+        deviceIndex.erase(dev.addrKey);
+    }
+    if (dev.fingerprint != 0 && fingerprintIndex.find(dev.fingerprint) == idx) {
+        fingerprintIndex.erase(dev.fingerprint);
+    }
+    
+    if (idx != last) {
+        TrackedDevice& moved = trackedDevices[last];
+        deviceIndex.insert(moved.key, idx);
+        if (moved.addrKey != moved.key) {
+            deviceIndex.insert(moved.addrKey, idx);
+        }
+        if (moved.fingerprint != 0 && fingerprintIndex.find(moved.fingerprint) == last) {
+            fingerprintIndex.insert(moved.fingerprint, idx);
+        }
+        dev = std::move(moved);
+    }
+    trackedDevices.pop_back();
+    tableVersion++;
+}
+
+void tracking_closeRound() {
+    if (roundState == ROUND_OPEN) {
+        roundState = ROUND_CLOSED;
+        sweepCursor = 0;
+    }
+}
+
+bool tracking_step(uint32_t budgetUs, int maxItems) {
+    if (roundState == ROUND_IDLE) return true;
+    
+    unsigned long start = micros();
+    int done = 0;
+    
+    // The clock is only read every few items
+    auto exhausted = [&]() {
+        done++;
+        if (maxItems > 0 && done >= maxItems) return true;
+        return (done & 7) == 0 && micros() - start >= budgetUs;
+    };
+    bool outOfBudget = false;
+    bool finished = false;
+    
+    while (!outOfBudget && pendingAPHead < pendingAPs.size()) {
+        ingestAP(pendingAPs[pendingAPHead++]);
+        outOfBudget = exhausted();
+    }
+    while (!outOfBudget && pendingHead < pendingDevices.size()) {
+        ingestDevice(pendingDevices[pendingHead++]);
+        outOfBudget = exhausted();
+    }
+    
+    bool drained = pendingAPHead == pendingAPs.size() && pendingHead == pendingDevices.size();
+    if (!outOfBudget && drained && roundState == ROUND_CLOSED) {
+        pendingAPs.clear();
+        pendingAPHead = 0;
+        pendingDevices.clear();
+        pendingHead = 0;
+        
+        // Sightings hold table indices; apply them before entries move
+        flushSightings();
+        
+        // Remove devices that haven't been seen recently
+        while (!outOfBudget && sweepCursor < trackedDevices.size()) {
+            const TrackedDevice& dev = trackedDevices[sweepCursor];
+            if (roundTime - dev.lastSeen > deviceTimeout) {
+                evictDevice(sweepCursor);  // Re-check the entry moved in
+            } else {
+                sweepCursor++;
+            }
+            outOfBudget = exhausted();
+        }
+        finished = sweepCursor >= trackedDevices.size();
+    }
+    
+    // Readers between slices see every sighting applied and counted
+    flushSightings();
+    
+    if (finished) {
+        roundState = ROUND_IDLE;
+        lastUpdateTime = roundTime;
+        publish();
+    }
+    return finished;
+}
+
+bool tracking_roundInProgress() {
+    return roundState != ROUND_IDLE;
+}
+
+void tracking_endRound() {
+    finishRound();
+}
+
+void tracking_update(const std::vector<Device>& wifiDevices, 
+                     const std::vector<Device>& btDevices) {
+    tracking_beginRound();
+    tracking_ingest(wifiDevices);
+    tracking_ingest(btDevices);
+    tracking_endRound();
 }
 
 std::vector<TrackedDevice> tracking_getAllDevices() {
     return trackedDevices;
 }
 
+const std::vector<TrackedDevice>& tracking_view() {
+    return trackedDevices;
+}
+
 std::vector<TrackedDevice> tracking_getDevicesByType(DeviceType type) {
     std::vector<TrackedDevice> filtered;
     
-    for (const auto& dev : trackedDevices) {
-        if (dev.type == type) {
-            filtered.push_back(dev);
-        }
-    }
+    tracking_forEach(ByType(type), [&](const TrackedDevice& dev) {
+        filtered.push_back(dev);
+    });
     
     return filtered;
 }
 
+// Distance at most max; unknown (-1) distances match, as they always have
+// for tracking_getNearbyDevices()
+struct AtMostDistance : Predicate<AtMostDistance> {
+    float max;
+    explicit AtMostDistance(float max) : max(max) {}
+    bool operator()(const TrackedDevice& dev) const { return dev.distance <= max; }
+};
+
 std::vector<TrackedDevice> tracking_getNearbyDevices(float maxDistance) {
     std::vector<TrackedDevice> nearby;
     
-    for (const auto& dev : trackedDevices) {
-        if (dev.distance <= maxDistance) {
-            nearby.push_back(dev);
-        }
-    }
+    tracking_forEach(AtMostDistance(maxDistance), [&](const TrackedDevice& dev) {
+        nearby.push_back(dev);
+    });
     
     // Sort by distance (closest first)
-    std::sort(nearby.begin(), nearby.end(),
-        [](const TrackedDevice& a, const TrackedDevice& b) {
-            return a.distance < b.distance;
-        });
+    std::sort(nearby.begin(), nearby.end(), OrderByDistance());
     
     return nearby;
 }
 
+TrackedDevice* tracking_getDeviceByKey(uint64_t key) {
+    int idx = findDeviceIndex(key);
+    if (idx >= 0) {
+        return &trackedDevices[idx];
+    }
+    return nullptr;
+}
+
 TrackedDevice* tracking_getDeviceByMAC(const String& mac) {
-    int idx = findDeviceIndex(mac);
+    int idx = findDeviceIndex(mac_toKey(mac.c_str()));
     if (idx >= 0) {
         return &trackedDevices[idx];
     }
     return nullptr;
 }
 
+uint32_t tracking_version() {
+    return publishedVersion;
+}
+
+int tracking_capacity() {
+    return tableCapacity;
+}
+
 int tracking_getDeviceCount() {
     return trackedDevices.size();
 }
 
+void tracking_setTimeout(unsigned long timeoutMs) {
+    deviceTimeout = timeoutMs;
+}
+
 void tracking_clear() {
     trackedDevices.clear();
+    pendingCount = 0;
+    pendingAPs.clear();
+    pendingAPHead = 0;
+    pendingDevices.clear();
+    pendingHead = 0;
+    newDeviceKeys.clear();
+    roundState = ROUND_IDLE;
+    rebuildIndices();
+    resetStats();
+    tableVersion++;
+    publish();
     Serial.println("All tracked devices cleared");
 }
 
+TrackingStats tracking_stats() {
+    return publishedStats;
+}
+
 // Get statistics
 void tracking_printStats() {
+    TrackingStats s = tracking_stats();
+    
     Serial.println("\n=== Device Tracking Statistics ===");
-    Serial.printf("Total devices: %d\n", trackedDevices.size());
+    Serial.printf("Total devices: %u\n", s.total);
+    Serial.printf("WiFi APs: %u\n", s.byType[TYPE_WIFI_AP]);
+    Serial.printf("BLE Devices: %u\n", s.byType[TYPE_BLUETOOTH]);
+    Serial.printf("WiFi Clients: %u\n", s.byType[TYPE_WIFI_CLIENT]);
+    Serial.printf("Merged rotating BLE addresses: %u\n", s.merged);
+    Serial.printf("Returning devices: %u\n", s.returning);
+    if (s.dropped > 0) {
+        Serial.printf("Dropped (table full): %u\n", s.dropped);
+    }
     
-    int wifiCount = 0, bleCount = 0, clientCount = 0;
+    Serial.print("Proximity:");
+    for (int p = 0; p < PROXIMITY_COUNT; p++) {
+        Serial.printf(" %s %u", proximityName((Proximity)p), s.byProximity[p]);
+    }
+    Serial.println();
     
-    for (const auto& dev : trackedDevices) {
-        if (dev.type == TYPE_WIFI_AP) wifiCount++;
-        else if (dev.type == TYPE_BLUETOOTH) bleCount++;
-        else clientCount++;
+    Serial.print("Vendors:");
+    for (int v = 0; v < VENDOR_COUNT; v++) {
+        if (s.byVendor[v] > 0) {
+            Serial.printf(" %s %u", vendorName((Vendor)v), s.byVendor[v]);
+        }
     }
+    Serial.println();
     
-    Serial.printf("WiFi APs: %d\n", wifiCount);
-    Serial.printf("BLE Devices: %d\n", bleCount);
-    Serial.printf("WiFi Clients: %d\n", clientCount);
+    Serial.print("Channels:");
+    for (int ch = 1; ch < TRACKING_CHANNEL_SLOTS; ch++) {
+        if (s.byChannel[ch] > 0) {
+            Serial.printf(" %d:%u", ch, s.byChannel[ch]);
+        }
+    }
+    Serial.println();
     
-    // Find closest device
-    if (!trackedDevices.empty()) {
-        auto closest = std::min_element(trackedDevices.begin(), trackedDevices.end(),
-            [](const TrackedDevice& a, const TrackedDevice& b) {
-                return a.distance < b.distance;
-            });
-        
-        Serial.printf("\nClosest device: %s (%.2fm)\n", 
-                     closest->name.c_str(), closest->distance);
+    if (s.withDistance > 0) {
+        Serial.printf("\nClosest: %.2fm, mean: %.2fm (%u with distance)\n",
+                      s.minDistance, s.meanDistance, s.withDistance);
     }
     
     Serial.println("==================================\n");
-}
\ No newline at end of file
+    
+    intern_printStats();
+}
+
+// Synthetic BLE sightings for devices first..first+count-1
+static std::vector<Device> benchmarkRound(int first, int count) {
+    std::vector<Device> devices(count);
+    char mac[18];
+    
+    for (int i = 0; i < count; i++) {
+        uint32_t id = first + i;
+        snprintf(mac, sizeof(mac), "02:00:%02X:%02X:%02X:%02X",
+                 (id >> 24) & 0xFF, (id >> 16) & 0xFF, (id >> 8) & 0xFF, id & 0xFF);
+        Device& dev = devices[i];
+        dev.mac = mac;
+        dev.rssi = -40 - (int)(id % 50);
+        dev.distance = rssi_distance(dev.rssi);
+        dev.type = TYPE_BLUETOOTH;
+        dev.channel = 0;
+        dev.vendor = VENDOR_UNKNOWN;
+        dev.fingerprint = 0;
+        dev.rotatingAddress = false;
+        dev.addrType = 0;
+    }
+    return devices;
+}
+
+TrackingBenchmark tracking_benchmark(int count, uint32_t budgetUs) {
+    TrackingBenchmark result = { count, budgetUs, 0, 0, 0 };
+    unsigned long savedTimeout = deviceTimeout;
+    int half = count / 2;
+    
+    // Every round sees half the table again, adds as many new devices and
+    // evicts the other half (zero timeout)
+    tracking_clear();
+    tracking_setTimeout(0);
+    tracking_update(benchmarkRound(0, count), std::vector<Device>());
+    delay(2);
+    
+    std::vector<Device> next = benchmarkRound(half, count);
+    unsigned long start = micros();
+    tracking_update(next, std::vector<Device>());
+    result.updateUs = micros() - start;
+    delay(2);
+    
+    tracking_beginRound();
+    tracking_submit(benchmarkRound(count, count));
+    tracking_closeRound();
+    bool done = false;
+    while (!done) {
+        start = micros();
+        done = tracking_step(budgetUs);
+        uint32_t slice = micros() - start;
+        result.sliceUs = (std::max)(result.sliceUs, slice);
+        result.slices++;
+    }
+    
+    tracking_clear();
+    tracking_setTimeout(savedTimeout);
+    return result;
+}
+
+QueryBenchmark tracking_queryBenchmark(int count, int repeat) {
+    QueryBenchmark result = { count, repeat, 0, 0, 0, 0 };
+    volatile int sink = 0;
+    
+    tracking_clear();
+    tracking_update(benchmarkRound(0, count), std::vector<Device>());
+    
+    // Five closest within 3 m: copy, filter and sort, then keep the head
+    unsigned long start = micros();
+    for (int r = 0; r < repeat; r++) {
+        std::vector<TrackedDevice> nearby = tracking_getNearbyDevices(3.0);
+        sink = sink + (int)(std::min)(nearby.size(), (size_t)5);
+    }
+    result.nearestLegacyUs = micros() - start;
+    
+    start = micros();
+    for (int r = 0; r < repeat; r++) {
+        auto nearby = tracking_query<5>(DistanceRange(0, 3.0), OrderByDistance());
+        sink = sink + nearby.size();
+    }
+    result.nearestQueryUs = micros() - start;
+    
+    // Count of one type
+    start = micros();
+    for (int r = 0; r < repeat; r++) {
+        sink = sink + (int)tracking_getDevicesByType(TYPE_BLUETOOTH).size();
+    }
+    result.countLegacyUs = micros() - start;
+    
+    start = micros();
+    for (int r = 0; r < repeat; r++) {
+        sink = sink + tracking_count(ByType(TYPE_BLUETOOTH));
+    }
+    result.countQueryUs = micros() - start;
+    
+    tracking_clear();
+    return result;
+}
@@ -2,46 +2,197 @@
 #include <vector>
 #include <Arduino.h>
 #include "../wifi/wifi_scanner.h"
+#include "../utils/distance.h"
+
+// Upper bound on simultaneously tracked devices (sizes the lookup indices)
+#ifndef MAX_TRACKED_DEVICES
+#define MAX_TRACKED_DEVICES 1024
+#endif
+
+// The table is reserved once in tracking_init(), as many entries as fit
+// after leaving this much heap free (never fewer than TRACKING_MIN_DEVICES)
+#ifndef TRACKING_HEAP_RESERVE
+#define TRACKING_HEAP_RESERVE (96 * 1024)
+#endif
+#ifndef TRACKING_MIN_DEVICES
+#define TRACKING_MIN_DEVICES 64
+#endif
+
+// Time given to each tracking_step() slice by the blocking wrappers
+#ifndef TRACKING_SLICE_US
+#define TRACKING_SLICE_US 4000
+#endif
 
 // Extended device information with tracking data
 struct TrackedDevice {
-    String mac;
-    String name;
+    String mac;     // Current address
+    uint64_t key;   // Packed MAC first seen; stable identity (see utils/mac_key.h)
+    uint64_t addrKey;       // Packed current address, differs after BLE rotation
+    uint32_t fingerprint;   // Advertisement fingerprint, 0 unless rotating BLE
+    uint16_t addressCount;  // Addresses this device has used
+    InternedName name;
     int rssi;
     float avgRSSI;  // Running average for stability
     float distance;
     DeviceType type;
     uint8_t channel;
+    Vendor vendor;
     unsigned long firstSeen;
     unsigned long lastSeen;
     int seenCount;
     bool isNew;  // True if discovered in the last scan
+    bool isNear; // RSSI above the approach threshold (see events.h)
+    bool isReturning; // Seen in an earlier visit (see presence_sketch.h)
+    uint8_t addrType;       // BLE address type, needed to connect
+    int8_t battery;         // Percent from the Battery service, -1 if unknown
+    InternedName manufacturer;  // From Device Information (see gatt_probe.h)
+    InternedName model;
+};
+
+// Table-wide aggregates, kept up to date as devices are added, updated and
+// evicted, so reading them never walks the table
+#define DEVICE_TYPE_COUNT 3
+#define TRACKING_CHANNEL_SLOTS 15   // 0 = no channel (BLE), 1-14
+
+struct TrackingStats {
+    uint16_t total;
+    uint16_t byType[DEVICE_TYPE_COUNT];         // Indexed by DeviceType
+    uint16_t byChannel[TRACKING_CHANNEL_SLOTS];
+    uint16_t byProximity[PROXIMITY_COUNT];      // See getProximity()
+    uint16_t byVendor[VENDOR_COUNT];
+    uint16_t withDistance;      // Devices with a known distance
+    float minDistance;          // Meters, -1 if none
+    float meanDistance;
+    uint32_t merged;            // Rotating BLE addresses merged
+    uint32_t returning;         // Seen in an earlier visit
+    uint32_t dropped;           // Not tracked, table full
 };
 
 // Initialize tracking system
 void tracking_init();
 
+// Devices the table can hold, as sized from the heap by tracking_init()
+int tracking_capacity();
+
 // Update tracked devices with new scan results
 void tracking_update(const std::vector<Device>& wifiDevices, 
                      const std::vector<Device>& btDevices);
 
+// The same update split into steps, so results can be fed in as each
+// radio (or each WiFi channel) finishes:
+//   tracking_beginRound();
+//   wifi_scanChannels(plan, count, tracking_ingestWiFi);
+//   tracking_ingest(bt_scan());
+//   tracking_endRound();     // evicts timed-out devices
+void tracking_beginRound();
+void tracking_ingest(const std::vector<Device>& devices);
+
+// Ingest a raw AP record; Strings are only built for a new AP
+void tracking_ingestWiFi(const wifi_ap_record_t& record);
+void tracking_endRound();
+
+// Budgeted rounds. Instead of ingesting and sweeping in one call, results
+// are queued and applied a slice at a time from loop(), so a dense scene
+// cannot starve the display or trip the task watchdog:
+//   tracking_beginRound();
+//   wifi_scanChannels(plan, count, tracking_submitWiFi);
+//   tracking_submit(bt_scan());
+//   tracking_closeRound();
+//   ... then every loop(): if (tracking_step(budgetUs)) { round done }
+// Between slices the table and indices are consistent (every queued
+// result is either fully applied or not yet touched, and evicted entries
+// are already gone) but hold a partly applied round. tracking_version()
+// and tracking_stats() only move when a round completes, so readers that
+// wait for a new version see whole rounds. tracking_beginRound() and
+// tracking_endRound() finish a round still in flight (closing it if it
+// is still open), yielding between slices.
+
+// Queue results for tracking_step(); the vector's contents are taken over
+void tracking_submit(std::vector<Device>&& devices);
+
+// Queue a raw AP record for tracking_step()
+void tracking_submitWiFi(const wifi_ap_record_t& record);
+
+// No more results this round; the timeout sweep runs once the queue is empty
+void tracking_closeRound();
+
+// Work on the current round for about budgetUs microseconds, or at most
+// maxItems devices if that is positive. Returns true once the round is
+// fully applied (also when no round is in progress).
+bool tracking_step(uint32_t budgetUs, int maxItems = 0);
+bool tracking_roundInProgress();
+
+// Insert a device saved before a reboot (see storage/device_store.h).
+// No events are published and the history/sketch are left alone.
+// Returns false if the table is full or the device is already tracked.
+bool tracking_restore(const TrackedDevice& device);
+
 // Get all tracked devices
 std::vector<TrackedDevice> tracking_getAllDevices();
 
+// Read-only view of the live table, without copying. References and
+// indices stay valid until the next tracking_update(), tracking_step() or
+// tracking_clear(); eviction moves the last entry into the freed slot.
+// See query.h for filtered/sorted access.
+const std::vector<TrackedDevice>& tracking_view();
+
 // Get devices filtered by type
 std::vector<TrackedDevice> tracking_getDevicesByType(DeviceType type);
 
-// Get devices within a certain distance
+// Get devices within a certain distance, closest first. Devices whose
+// distance is not known yet (-1, e.g. restored after a reboot) are included.
 std::vector<TrackedDevice> tracking_getNearbyDevices(float maxDistance);
 
 // Get a specific device by MAC address
 TrackedDevice* tracking_getDeviceByMAC(const String& mac);
 
+// Get a specific device by packed MAC key
+TrackedDevice* tracking_getDeviceByKey(uint64_t key);
+
+// Changes when a round completes (or a device is restored, or the table
+// cleared, outside a round), so views can tell when something they
+// derived from the table is stale without rebuilding mid-round
+uint32_t tracking_version();
+
 // Get device count
 int tracking_getDeviceCount();
 
+// Time without a sighting before a device is dropped (default 10 s).
+// Must exceed the time between scan rounds.
+void tracking_setTimeout(unsigned long timeoutMs);
+
 // Clear all tracked devices
 void tracking_clear();
 
+// Aggregates as of the last completed round; O(1). Plain data, safe to
+// copy or send as is.
+TrackingStats tracking_stats();
+
+// Worst-case latency at a given table size: one blocking tracking_update()
+// against the slowest tracking_step() slice for the same workload (half
+// the table re-seen, half new, half evicted). Clears the table; run it
+// before the event bus, history and sketch are initialized.
+struct TrackingBenchmark {
+    int count;
+    uint32_t budgetUs;
+    uint32_t updateUs;      // Whole round in one call
+    uint32_t sliceUs;       // Longest slice
+    int slices;
+};
+TrackingBenchmark tracking_benchmark(int count, uint32_t budgetUs);
+
+// The copying accessors against the equivalent query.h templates, each run
+// `repeat` times over `count` devices (total microseconds). Clears the
+// table; same constraints as tracking_benchmark().
+struct QueryBenchmark {
+    int count;
+    int repeat;
+    uint32_t nearestLegacyUs;   // tracking_getNearbyDevices(), first five
+    uint32_t nearestQueryUs;    // tracking_query<5>(DistanceRange, OrderByDistance)
+    uint32_t countLegacyUs;     // tracking_getDevicesByType().size()
+    uint32_t countQueryUs;      // tracking_count(ByType)
+};
+QueryBenchmark tracking_queryBenchmark(int count, int repeat);
+
 // Print tracking statistics
 void tracking_printStats();
\ No newline at end of file
@@ -35,13 +35,37 @@ inline float estimateDistanceBLE(int rssi) {
     return estimateDistance(rssi, -59, 2.0);
 }
 
+// Proximity categories, from closest to farthest
+enum Proximity : uint8_t {
+    PROXIMITY_UNKNOWN,
+    PROXIMITY_IMMEDIATE,
+    PROXIMITY_NEAR,
+    PROXIMITY_MEDIUM,
+    PROXIMITY_FAR,
+    PROXIMITY_COUNT
+};
+
+inline Proximity getProximity(float distance) {
+    if (distance < 0) return PROXIMITY_UNKNOWN;
+    if (distance < 1.0) return PROXIMITY_IMMEDIATE;
+    if (distance < 3.0) return PROXIMITY_NEAR;
+    if (distance < 10.0) return PROXIMITY_MEDIUM;
+    return PROXIMITY_FAR;
+}
+
+inline const char* proximityName(Proximity proximity) {
+    switch (proximity) {
+        case PROXIMITY_IMMEDIATE: return "Immediate";
+        case PROXIMITY_NEAR:      return "Near";
+        case PROXIMITY_MEDIUM:    return "Medium";
+        case PROXIMITY_FAR:       return "Far";
+        default:                  return "Unknown";
+    }
+}
+
 // Convert distance to proximity category
 inline String getProximityCategory(float distance) {
-    if (distance < 0) return "Unknown";
-    if (distance < 1.0) return "Immediate";
-    if (distance < 3.0) return "Near";
-    if (distance < 10.0) return "Medium";
-    return "Far";
+    return proximityName(getProximity(distance));
 }
 
 // Signal quality indicator
@@ -0,0 +1,179 @@
+#include "intern.h"
+#include "key_index.h"
+#include <vector>
+
+#if defined(ARDUINO)
+// Heap in use up to a constant; only differences are meaningful
+static long heapMark() { return -(long)ESP.getFreeHeap(); }
+#else
+#include <malloc.h>
+static long heapMark() { return (long)mallinfo2().uordblks; }
+#endif
+
+struct InternEntry {
+    char* str;
+    uint64_t key;     // Key under which the index holds this entry
+    uint16_t len;
+    uint16_t refs;    // 0 = free slot, REFS_PINNED = never freed
+};
+
+// Saturated count: the string stays for good rather than wrapping to 0
+const uint16_t REFS_PINNED = 0xFFFF;
+
+// Salted retries when two different strings share a 64-bit hash
+const int MAX_HASH_PROBES = 4;
+
+static InternEntry entries[MAX_INTERNED_NAMES];
+static NameId freeList[MAX_INTERNED_NAMES];
+static int freeCount = -1;   // -1 until the free list is built
+static KeyIndex<INTERN_INDEX_SIZE> nameIndex;
+static uint32_t overflowCount = 0;
+
+// FNV-1a, with 0 remapped since it marks an empty index cell
+static uint64_t hashString(const char* str, size_t len, int probe) {
+    uint64_t h = 0xcbf29ce484222325ULL + probe * 0x9e3779b97f4a7c15ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)str[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h == 0 ? 1 : h;
+}
+
+static void buildFreeList() {
+    // Handle 0 is reserved for the empty string
+    freeCount = 0;
+    for (int id = MAX_INTERNED_NAMES - 1; id >= 1; id--) {
+        freeList[freeCount++] = id;
+    }
+}
+
+NameId intern_acquire(const char* str, size_t len) {
+    if (len == 0) return 0;
+    if (freeCount < 0) buildFreeList();
+
+    uint64_t key = 0;
+    for (int probe = 0; probe < MAX_HASH_PROBES; probe++) {
+        key = hashString(str, len, probe);
+        uint16_t id = nameIndex.find(key);
+
+        if (id == nameIndex.NONE) break;
+
+        InternEntry& e = entries[id];
+        if (e.len == len && memcmp(e.str, str, len) == 0) {
+            if (e.refs != REFS_PINNED) e.refs++;
+            return id;
+        }
+        key = 0;
+    }
+
+    char* copy = nullptr;
+    if (key != 0 && freeCount > 0) {
+        copy = (char*)malloc(len + 1);
+    }
+    if (copy == nullptr) {
+        // Log the first failure and then at each power of two
+        overflowCount++;
+        if ((overflowCount & (overflowCount - 1)) == 0) {
+            Serial.printf("[INTERN] Pool full, %u names read as empty (%d in use)\n",
+                          overflowCount, MAX_INTERNED_NAMES - 1 - freeCount);
+        }
+        return 0;
+    }
+
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+
+    NameId id = freeList[--freeCount];
+    InternEntry& e = entries[id];
+    e.str = copy;
+    e.key = key;
+    e.len = len;
+    e.refs = 1;
+    nameIndex.insert(key, id);
+    return id;
+}
+
+void intern_retain(NameId id) {
+    if (id != 0 && entries[id].refs != REFS_PINNED) entries[id].refs++;
+}
+
+void intern_release(NameId id) {
+    if (id == 0) return;
+
+    InternEntry& e = entries[id];
+    if (e.refs == REFS_PINNED || --e.refs > 0) return;
+
+    nameIndex.erase(e.key);
+    free(e.str);
+    e.str = nullptr;
+    freeList[freeCount++] = id;
+}
+
+const char* intern_str(NameId id) {
+    return id == 0 ? "" : entries[id].str;
+}
+
+size_t intern_length(NameId id) {
+    return id == 0 ? 0 : entries[id].len;
+}
+
+uint32_t intern_failedAcquires() {
+    return overflowCount;
+}
+
+void intern_printStats() {
+    int unique = 0;
+    uint32_t refs = 0;
+    size_t stored = 0;
+
+    for (int id = 1; id < MAX_INTERNED_NAMES; id++) {
+        const InternEntry& e = entries[id];
+        if (e.refs == 0) continue;
+
+        unique++;
+        refs += e.refs;
+        stored += e.len + 1;
+    }
+
+    Serial.println("\n=== Name Pool ===");
+    Serial.printf("Unique names: %d / %d\n", unique, MAX_INTERNED_NAMES - 1);
+    Serial.printf("References: %u\n", refs);
+    Serial.printf("String bytes: %u, tables: %u\n", (unsigned)stored,
+                  (unsigned)(sizeof(entries) + sizeof(freeList) + sizeof(nameIndex)));
+    Serial.printf("Failed acquires: %u\n", overflowCount);
+    Serial.println("=================\n");
+}
+
+InternBenchmark intern_benchmark(int count, int distinct) {
+    InternBenchmark result;
+    result.count = count;
+    result.distinct = distinct;
+    result.poolBytes = sizeof(entries) + sizeof(freeList) + sizeof(nameIndex);
+
+    // SSID-like names, mostly past the String's inline buffer
+    std::vector<String> labels;
+    for (int i = 0; i < distinct; i++) {
+        char name[33];
+        snprintf(name, sizeof(name), "Site-Network-%03d%s", i, i % 3 ? "-5G" : "");
+        labels.push_back(name);
+    }
+
+    long start = heapMark();
+    {
+        std::vector<String> owners(count);
+        for (int i = 0; i < count; i++) {
+            owners[i] = labels[i % distinct].c_str();   // Deep copy, as before
+        }
+        result.stringBytes = heapMark() - start;
+    }
+
+    start = heapMark();
+    {
+        std::vector<InternedName> owners(count);
+        for (int i = 0; i < count; i++) {
+            owners[i] = InternedName(labels[i % distinct]);
+        }
+        result.internBytes = heapMark() - start;
+    }
+    return result;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <Arduino.h>
+
+// Hash-consed string pool for device names and SSIDs.
+//
+// Every distinct string is stored once and referred to by a 16-bit handle
+// with a reference count, so hundreds of BSSIDs sharing one SSID (or BLE
+// devices sharing a vendor label) cost two bytes each and comparing names
+// is a handle compare. Handle 0 is the empty string. Not thread-safe: all
+// users run from loop().
+
+// Maximum distinct strings alive at once: one name per tracked device
+// (MAX_TRACKED_DEVICES) plus manufacturer and model for each GATT cache
+// entry, with some headroom for scan results in flight
+#ifndef MAX_INTERNED_NAMES
+#define MAX_INTERNED_NAMES 1280
+#endif
+
+// Hash index slots; a power of two, comfortably above MAX_INTERNED_NAMES
+#ifndef INTERN_INDEX_SIZE
+#define INTERN_INDEX_SIZE 2048
+#endif
+
+typedef uint16_t NameId;
+
+// Look up or insert a string and take a reference to it. Returns 0 for the
+// empty string, or when the pool is full (counted, see intern_failedAcquires).
+// A string referenced 65535 times is pinned and never freed.
+NameId intern_acquire(const char* str, size_t len);
+
+// Reference counting for handles obtained from intern_acquire
+void intern_retain(NameId id);
+void intern_release(NameId id);
+
+// String for a handle (never null)
+const char* intern_str(NameId id);
+size_t intern_length(NameId id);
+
+// Acquires that returned 0 because the pool or the heap was exhausted
+uint32_t intern_failedAcquires();
+
+// Print pool usage
+void intern_printStats();
+
+// Heap cost of `count` owners of names drawn from `distinct` strings, held
+// as one String each against one InternedName each. Measured from the
+// allocator (free heap on the board, malloc statistics on a host), so
+// build with -D INTERN_BENCHMARK and run it early in setup().
+struct InternBenchmark {
+    int count;
+    int distinct;
+    long stringBytes;     // Heap taken by the Strings
+    long internBytes;     // Heap taken by the handles and pooled copies
+    size_t poolBytes;     // The pool's fixed tables (static, not heap)
+};
+InternBenchmark intern_benchmark(int count, int distinct);
+
+// Owning handle with value semantics, a drop-in for the String name fields
+class InternedName {
+public:
+    InternedName() : id(0) {}
+    InternedName(const char* str) : id(intern_acquire(str, strlen(str))) {}
+    InternedName(const String& str) : id(intern_acquire(str.c_str(), str.length())) {}
+    InternedName(const InternedName& other) : id(other.id) { intern_retain(id); }
+    ~InternedName() { intern_release(id); }
+
+    InternedName& operator=(const InternedName& other) {
+        if (id != other.id) {
+            intern_retain(other.id);
+            intern_release(id);
+            id = other.id;
+        }
+        return *this;
+    }
+
+    // Equal strings always share a handle
+    bool equals(const InternedName& other) const { return id == other.id; }
+    bool operator==(const InternedName& other) const { return id == other.id; }
+    bool operator!=(const InternedName& other) const { return id != other.id; }
+
+    bool isEmpty() const { return id == 0; }
+    const char* c_str() const { return intern_str(id); }
+    size_t length() const { return intern_length(id); }
+    NameId handle() const { return id; }
+
+private:
+    NameId id;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "mac_key.h"
+
+// Fixed-capacity open-addressing map from a 64-bit key (usually a packed
+// MAC) to a 16-bit slot number. Linear probing with backward-shift deletion,
+// so lookups stay O(1) without tombstones. Key 0 marks an empty cell.
+// CAPACITY must be a power of two and should be ~2x the live entries.
+template <int CAPACITY>
+class KeyIndex {
+public:
+    static const uint16_t NONE = 0xFFFF;
+
+    KeyIndex() { clear(); }
+
+    void clear() {
+        memset(keys, 0, sizeof(keys));
+        count = 0;
+    }
+
+    int size() const { return count; }
+
+    uint16_t find(uint64_t key) const {
+        if (key == 0) return NONE;
+        for (uint32_t i = mac_hash(key) & MASK;; i = (i + 1) & MASK) {
+            if (keys[i] == key) return values[i];
+            if (keys[i] == 0) return NONE;
+        }
+    }
+
+    // Insert or overwrite; false when the table is full
+    bool insert(uint64_t key, uint16_t value) {
+        if (key == 0) return false;
+        for (uint32_t i = mac_hash(key) & MASK;; i = (i + 1) & MASK) {
+            if (keys[i] == key) {
+                values[i] = value;
+                return true;
+            }
+            if (keys[i] == 0) {
+                if (count >= CAPACITY - 1) return false;
+                keys[i] = key;
+                values[i] = value;
+                count++;
+                return true;
+            }
+        }
+    }
+
+    void erase(uint64_t key) {
+        if (key == 0) return;
+        uint32_t i = mac_hash(key) & MASK;
+        while (keys[i] != key) {
+            if (keys[i] == 0) return;
+            i = (i + 1) & MASK;
+        }
+
+        // Shift later members of the probe chain back into the hole
+        uint32_t hole = i;
+        for (uint32_t j = (i + 1) & MASK; keys[j] != 0; j = (j + 1) & MASK) {
+            uint32_t home = mac_hash(keys[j]) & MASK;
+            bool movable = (hole <= j) ? (home <= hole || home > j)
+                                       : (home <= hole && home > j);
+            if (movable) {
+                keys[hole] = keys[j];
+                values[hole] = values[j];
+                hole = j;
+            }
+        }
+        keys[hole] = 0;
+        count--;
+    }
+
+private:
+    static const uint32_t MASK = CAPACITY - 1;
+    uint64_t keys[CAPACITY];
+    uint16_t values[CAPACITY];
+    int count;
+};
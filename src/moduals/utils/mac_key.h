@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Packed 48-bit MAC keys. Fixed-size tables use these instead of the
+// "AA:BB:CC:DD:EE:FF" strings; 0 is never a valid device address and doubles
+// as the empty marker.
+
+// Parse "AA:BB:CC:DD:EE:FF" (either case), first octet in the high byte
+inline bool mac_parse(const char* str, uint64_t* out) {
+    uint64_t mac = 0;
+    for (int i = 0; i < 6; i++) {
+        char* end;
+        unsigned long octet = strtoul(str, &end, 16);
+        if (end != str + 2 || octet > 0xFF) return false;
+        mac = (mac << 8) | octet;
+        str = end;
+        if (i < 5) {
+            if (*str != ':') return false;
+            str++;
+        }
+    }
+    *out = mac;
+    return true;
+}
+
+// Parse, returning 0 for anything malformed
+inline uint64_t mac_toKey(const char* str) {
+    uint64_t key;
+    return mac_parse(str, &key) ? key : 0;
+}
+
+// Pack six address bytes as they appear on air
+inline uint64_t mac_fromBytes(const uint8_t* bytes) {
+    uint64_t mac = 0;
+    for (int i = 0; i < 6; i++) {
+        mac = (mac << 8) | bytes[i];
+    }
+    return mac;
+}
+
+// Format back to "AA:BB:CC:DD:EE:FF" (out must hold 18 bytes)
+inline void mac_format(uint64_t mac, char* out) {
+    snprintf(out, 18, "%02X:%02X:%02X:%02X:%02X:%02X",
+             (unsigned)(mac >> 40) & 0xFF, (unsigned)(mac >> 32) & 0xFF,
+             (unsigned)(mac >> 24) & 0xFF, (unsigned)(mac >> 16) & 0xFF,
+             (unsigned)(mac >> 8) & 0xFF, (unsigned)mac & 0xFF);
+}
+
+// Cheap 64-bit mixer for hashing keys into power-of-two tables
+inline uint32_t mac_hash(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
@@ -0,0 +1,126 @@
+#include "rssi_kernels.h"
+#include <math.h>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<esp_dsp.h>)
+#include <esp_dsp.h>
+#define RSSI_USE_ESP_DSP 1
+#endif
+#endif
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+static uint32_t ticks() { return ESP.getCycleCount(); }
+static const char* TICK_UNIT = "cycles";
+#else
+#include <chrono>
+static uint32_t ticks() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static const char* TICK_UNIT = "ns";
+#endif
+
+// Index 0 is 0 dBm, index 127 is -127 dBm
+static float distanceTable[128];
+static bool tableReady = false;
+
+static float pathLossDistance(int rssi) {
+    if (rssi == 0) return -1.0;
+    // Same float rounding of the exponent as estimateDistance()
+    float ratio = (RSSI_TX_POWER - rssi) / (10.0 * RSSI_PATH_LOSS);
+    return pow(10.0, ratio);
+}
+
+static void buildTable() {
+    for (int i = 0; i < 128; i++) {
+        distanceTable[i] = pathLossDistance(-i);
+    }
+    tableReady = true;
+}
+
+float rssi_distance(int rssi) {
+    if (!tableReady) buildTable();
+    int idx = rssi >= 0 ? 0 : (rssi < -127 ? 127 : -rssi);
+    return distanceTable[idx];
+}
+
+void rssi_distanceBatch(const int8_t* rssi, float* distance, int n) {
+    if (!tableReady) buildTable();
+    for (int i = 0; i < n; i++) {
+        int r = rssi[i];
+        int idx = r >= 0 ? 0 : (r < -127 ? 127 : -r);
+        distance[i] = distanceTable[idx];
+    }
+}
+
+void rssi_smoothBatch(float* avg, const float* sample, const float* weight,
+                      float* scratch, int n) {
+#ifdef RSSI_USE_ESP_DSP
+    dsps_sub_f32(sample, avg, scratch, n, 1, 1, 1);
+    dsps_mul_f32(scratch, weight, scratch, n, 1, 1, 1);
+    dsps_add_f32(avg, scratch, avg, n, 1, 1, 1);
+#else
+    (void)scratch;
+    for (int i = 0; i < n; i++) {
+        avg[i] += (sample[i] - avg[i]) * weight[i];
+    }
+#endif
+}
+
+void rssi_bucketBatch(const float* distance, uint8_t* bucket, int n,
+                      float width, uint8_t maxBucket) {
+    const float scale = 1.0f / width;
+    const float top = maxBucket;
+    for (int i = 0; i < n; i++) {
+        float b = distance[i] * scale;
+        b = b < 0 ? top : b;
+        b = b > top ? top : b;
+        bucket[i] = (uint8_t)b;
+    }
+}
+
+RssiBenchmark rssi_benchmark(int count) {
+    std::vector<int8_t> rssi(count);
+    std::vector<float> avg(count), sample(count), weight(count), scratch(count), dist(count);
+    std::vector<int> seen(count);
+
+    // Deterministic spread of readings and history lengths
+    uint32_t seed = 12345;
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        rssi[i] = -30 - (int)((seed >> 16) % 70);
+        seen[i] = 1 + (seed >> 8) % 50;
+        avg[i] = rssi[i] + 3;
+    }
+    if (!tableReady) buildTable();
+
+    RssiBenchmark result;
+    result.count = count;
+    result.unit = TICK_UNIT;
+
+    // Per-device path, as tracking_update() used to do it
+    std::vector<float> scalarAvg = avg;
+    volatile float sink = 0;
+    uint32_t start = ticks();
+    for (int i = 0; i < count; i++) {
+        scalarAvg[i] = (scalarAvg[i] * (seen[i] - 1) + rssi[i]) / seen[i];
+        dist[i] = pathLossDistance(rssi[i]);
+    }
+    result.scalarTicks = ticks() - start;
+    sink = sink + dist[count / 2];
+
+    // Batched path; gathering the inputs is part of the cost
+    start = ticks();
+    for (int i = 0; i < count; i++) {
+        sample[i] = rssi[i];
+        weight[i] = 1.0f / seen[i];
+    }
+    rssi_smoothBatch(avg.data(), sample.data(), weight.data(), scratch.data(), count);
+    rssi_distanceBatch(rssi.data(), dist.data(), count);
+    result.batchTicks = ticks() - start;
+    sink = sink + dist[count / 2];
+
+    return result;
+}
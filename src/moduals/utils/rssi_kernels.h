@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+
+// Batched RSSI arithmetic over contiguous arrays.
+//
+// The tracker collects each round's sightings into flat arrays and folds
+// them in with these kernels instead of doing float math per device:
+//   - RSSI -> distance is a 128-entry lookup table (RSSI is whole dBm),
+//     built once with the same path-loss model as estimateDistance()
+//   - running-average smoothing is an element-wise multiply-add, done with
+//     esp-dsp's vector routines when the library is available (they use
+//     the ESP32-S3 SIMD instructions) and a plain loop the compiler can
+//     auto-vectorize otherwise
+//   - distance bucketing is a branch-free scale-and-clamp
+// No Arduino headers, so the kernels also build and run on a host.
+
+// Path-loss model; keep in sync with the estimateDistance() defaults
+#define RSSI_TX_POWER -59
+#define RSSI_PATH_LOSS 2.0
+
+// Distance in meters for a reading, -1 for 0 dBm (invalid) like
+// estimateDistance(). Readings outside -127..0 are clamped.
+float rssi_distance(int rssi);
+
+// distance[i] = rssi_distance(rssi[i])
+void rssi_distanceBatch(const int8_t* rssi, float* distance, int n);
+
+// avg[i] += (sample[i] - avg[i]) * weight[i]; scratch holds n floats
+void rssi_smoothBatch(float* avg, const float* sample, const float* weight,
+                      float* scratch, int n);
+
+// bucket[i] = min(distance[i] / width, maxBucket); unknown (negative)
+// distances go to maxBucket
+void rssi_bucketBatch(const float* distance, uint8_t* bucket, int n,
+                      float width, uint8_t maxBucket);
+
+// Time the per-device scalar path (pow + running mean) against the
+// kernels over `count` synthetic readings. Ticks are CPU cycles on the
+// board and nanoseconds on a host.
+struct RssiBenchmark {
+    int count;
+    uint32_t scalarTicks;
+    uint32_t batchTicks;
+    const char* unit;
+};
+RssiBenchmark rssi_benchmark(int count);
@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+
+// Coarse vendor classification shared by the scanners, tracker and queries.
+// BLE devices are classified from the Bluetooth SIG company identifier in
+// their manufacturer data.
+
+enum Vendor : uint8_t {
+    VENDOR_UNKNOWN,
+    VENDOR_APPLE,
+    VENDOR_SAMSUNG,
+    VENDOR_GOOGLE,
+    VENDOR_MICROSOFT,
+    VENDOR_GARMIN,
+    VENDOR_BOSE,
+    VENDOR_SONY,
+    VENDOR_COUNT
+};
+
+inline Vendor vendorFromCompanyId(uint16_t companyId) {
+    switch (companyId) {
+        case 0x004C: return VENDOR_APPLE;
+        case 0x0075: return VENDOR_SAMSUNG;
+        case 0x00E0: return VENDOR_GOOGLE;
+        case 0x0006: return VENDOR_MICROSOFT;
+        case 0x0087: return VENDOR_GARMIN;
+        case 0x0157: return VENDOR_BOSE;
+        case 0x00A8: return VENDOR_SONY;
+        default:     return VENDOR_UNKNOWN;
+    }
+}
+
+inline const char* vendorName(Vendor vendor) {
+    switch (vendor) {
+        case VENDOR_APPLE:     return "Apple";
+        case VENDOR_SAMSUNG:   return "Samsung";
+        case VENDOR_GOOGLE:    return "Google";
+        case VENDOR_MICROSOFT: return "Microsoft";
+        case VENDOR_GARMIN:    return "Garmin";
+        case VENDOR_BOSE:      return "Bose";
+        case VENDOR_SONY:      return "Sony";
+        default:               return "Unknown";
+    }
+}
@@ -0,0 +1,217 @@
+#include "channel_stats.h"
+#include "wifi_scanner.h"
+#include "../utils/mac_key.h"
+#include <algorithm>
+
+// Transmitter HyperLogLog per channel: 2^6 registers, ~13% error
+#define TX_HLL_BITS 6
+#define TX_HLL_REGISTERS (1 << TX_HLL_BITS)
+
+// Counters for one channel over one window
+struct ChannelWindow {
+    uint32_t frames[FRAME_CLASS_COUNT][16];   // By type and subtype
+    uint32_t airtimeUs;
+    uint16_t rssiHistogram[CHSTATS_RSSI_BINS];
+    uint8_t transmitters[TX_HLL_REGISTERS];
+    uint32_t listenMs;                        // Written by loop() only
+};
+
+// The sniffer writes windows[active]; windows[active ^ 1] is the last
+// completed window and only loop() touches it
+static ChannelWindow windows[2][CHSTATS_CHANNELS];
+static volatile uint8_t active = 0;
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t hopChannel = 1;
+static unsigned long lastHop = 0;
+static unsigned long windowStart = 0;
+static bool listening = false;
+
+// Non-HT PHY rates by rx_ctrl.rate code, in 100 kbit/s (0 = unused code)
+static const uint16_t LEGACY_RATES[16] = {
+    10, 20, 55, 110, 0, 20, 55, 110, 480, 240, 120, 60, 540, 360, 180, 90
+};
+
+// HT MCS 0-7 rates for one spatial stream, 20 and 40 MHz, in 100 kbit/s
+static const uint16_t HT_RATES_20[8] = { 65, 130, 195, 260, 390, 520, 585, 650 };
+static const uint16_t HT_RATES_40[8] = { 135, 270, 405, 540, 810, 1080, 1215, 1350 };
+
+// Estimated time on air: preamble plus payload at the received PHY rate
+static uint32_t IRAM_ATTR airtimeUs(const wifi_pkt_rx_ctrl_t& ctrl, uint32_t len) {
+    uint32_t rate, preamble;
+
+    if (ctrl.sig_mode == 0) {
+        uint8_t code = ctrl.rate & 0x0F;
+        rate = LEGACY_RATES[code];
+        preamble = code < 4 ? 192 : (code < 8 ? 96 : 20);  // Long/short DSSS, OFDM
+    } else {
+        uint8_t mcs = ctrl.mcs;
+        const uint16_t* table = ctrl.cwb ? HT_RATES_40 : HT_RATES_20;
+        rate = table[mcs & 7] * ((mcs >> 3) + 1);
+        preamble = 36;
+    }
+    if (rate == 0) rate = 10;
+
+    return preamble + len * 80 / rate;
+}
+
+void chstats_init() {
+    portENTER_CRITICAL(&statsMux);
+    memset(windows, 0, sizeof(windows));
+    active = 0;
+    portEXIT_CRITICAL(&statsMux);
+
+    hopChannel = 1;
+    lastHop = millis();
+    windowStart = lastHop;
+}
+
+void IRAM_ATTR chstats_record(const wifi_pkt_rx_ctrl_t& ctrl, const uint8_t* payload) {
+    uint8_t channel = ctrl.channel;
+    if (channel < 1 || channel > CHSTATS_CHANNELS) return;
+
+    uint32_t len = ctrl.sig_len;
+    uint8_t fc = len > 0 ? payload[0] : 0;
+    uint8_t frameClass = (fc >> 2) & 0x03;
+    uint8_t subtype = fc >> 4;
+    uint32_t air = airtimeUs(ctrl, len);
+
+    int bin = (ctrl.rssi + 100) / 10;
+    bin = bin < 0 ? 0 : (bin >= CHSTATS_RSSI_BINS ? CHSTATS_RSSI_BINS - 1 : bin);
+
+    // Transmitter address (addr2); CTS and ACK frames do not carry one
+    bool hasSender = len >= 16 && !(frameClass == FRAME_CTRL && (subtype == 12 || subtype == 13));
+    uint32_t idx = 0;
+    uint8_t rank = 0;
+    if (hasSender) {
+        uint32_t h = mac_hash(mac_fromBytes(payload + 10));
+        uint32_t rest = h << TX_HLL_BITS;
+        idx = h >> (32 - TX_HLL_BITS);
+        rank = rest == 0 ? (32 - TX_HLL_BITS + 1) : __builtin_clz(rest) + 1;
+    }
+
+    portENTER_CRITICAL(&statsMux);
+    ChannelWindow& w = windows[active][channel - 1];
+    w.frames[frameClass][subtype]++;
+    w.airtimeUs += air;
+    w.rssiHistogram[bin]++;
+    if (rank > w.transmitters[idx]) w.transmitters[idx] = rank;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+// Credit the time since the last hop to the channel we were on
+static void accountListen(unsigned long now) {
+    if (listening) {
+        windows[active][hopChannel - 1].listenMs += now - lastHop;
+    }
+    lastHop = now;
+}
+
+void chstats_setListening(bool on) {
+    unsigned long now = millis();
+    accountListen(now);
+    listening = on;
+
+    // A scan leaves the radio on some other channel
+    if (on && WiFi.status() != WL_CONNECTED) wifi_set_channel(hopChannel);
+}
+
+bool chstats_service() {
+    unsigned long now = millis();
+
+    // Stay put while associated; hopping would drop the connection
+    if (now - lastHop >= CHSTATS_DWELL_MS) {
+        accountListen(now);
+        if (listening && WiFi.status() != WL_CONNECTED) {
+            hopChannel = hopChannel % CHSTATS_CHANNELS + 1;
+            wifi_set_channel(hopChannel);
+        }
+    }
+
+    if (now - windowStart < CHSTATS_WINDOW_MS) return false;
+
+    accountListen(now);
+    uint8_t next = active ^ 1;
+
+    // Nothing writes the inactive window, so it can be cleared unlocked
+    memset(windows[next], 0, sizeof(windows[next]));
+
+    portENTER_CRITICAL(&statsMux);
+    active = next;
+    portEXIT_CRITICAL(&statsMux);
+
+    windowStart = now;
+    return true;
+}
+
+static uint16_t hllEstimate(const uint8_t* registers) {
+    const float m = TX_HLL_REGISTERS;
+    float sum = 0;
+    int zeros = 0;
+
+    for (int i = 0; i < TX_HLL_REGISTERS; i++) {
+        sum += ldexpf(1.0f, -registers[i]);
+        if (registers[i] == 0) zeros++;
+    }
+    if (zeros == TX_HLL_REGISTERS) return 0;
+
+    float estimate = 0.709f * m * m / sum;
+    if (estimate <= 2.5f * m && zeros > 0) {
+        estimate = m * logf(m / zeros);
+    }
+    return (uint16_t)(estimate + 0.5f);
+}
+
+bool chstats_getChannel(uint8_t channel, ChannelSummary& out) {
+    if (channel < 1 || channel > CHSTATS_CHANNELS) return false;
+    const ChannelWindow& w = windows[active ^ 1][channel - 1];
+
+    memset(&out, 0, sizeof(out));
+    out.channel = channel;
+    out.listenMs = w.listenMs;
+
+    for (int c = 0; c < FRAME_CLASS_COUNT; c++) {
+        for (int s = 0; s < 16; s++) {
+            out.framesByClass[c] += w.frames[c][s];
+        }
+        out.frames += out.framesByClass[c];
+    }
+    out.beacons = w.frames[FRAME_MGMT][8];
+    out.probes = w.frames[FRAME_MGMT][4] + w.frames[FRAME_MGMT][5];
+
+    if (w.listenMs > 0) {
+        out.framesPerSecond = out.frames * 1000.0f / w.listenMs;
+        out.airtimePercent = (std::min)(100.0f, w.airtimeUs / (w.listenMs * 10.0f));
+    }
+    out.transmitters = hllEstimate(w.transmitters);
+
+    uint32_t seen = 0;
+    for (int b = 0; b < CHSTATS_RSSI_BINS; b++) {
+        out.rssiHistogram[b] = w.rssiHistogram[b];
+        seen += w.rssiHistogram[b];
+    }
+
+    // Median at bin resolution: centre of the bin holding the middle frame
+    uint32_t cumulative = 0;
+    for (int b = 0; b < CHSTATS_RSSI_BINS && seen > 0; b++) {
+        cumulative += w.rssiHistogram[b];
+        if (cumulative * 2 >= seen) {
+            out.rssiMedian = -95 + b * 10;
+            break;
+        }
+    }
+    return true;
+}
+
+void chstats_printReport(Print& out) {
+    ChannelSummary s;
+
+    out.println("[CHAN] ch  fps  air%  tx  rssi  mgmt/ctrl/data  bcn/probe");
+    for (uint8_t ch = 1; ch <= CHSTATS_CHANNELS; ch++) {
+        if (!chstats_getChannel(ch, s) || s.frames == 0) continue;
+        out.printf("[CHAN] %2u %5.0f %5.1f %3u %5d  %u/%u/%u  %u/%u\n",
+                   s.channel, s.framesPerSecond, s.airtimePercent, s.transmitters,
+                   s.rssiMedian, s.framesByClass[FRAME_MGMT], s.framesByClass[FRAME_CTRL],
+                   s.framesByClass[FRAME_DATA], s.beacons, s.probes);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_wifi.h>
+
+// Per-channel airtime and occupancy analytics from the promiscuous sniffer.
+//
+// chstats_record() is called from the sniffer callback for every frame and
+// does O(1) work on fixed counters: frames per type/subtype, estimated
+// airtime from length and PHY rate, a small HyperLogLog of transmitter
+// addresses and an RSSI histogram. Two window buffers are swapped under a
+// spinlock, so the callback never allocates and never waits on loop().
+//
+// chstats_service() runs from loop(): it hops the sniffer across channels
+// and closes a window every CHSTATS_WINDOW_MS. Readers only ever see the
+// last completed window.
+
+#define CHSTATS_CHANNELS 13
+
+// Report window and per-channel dwell while hopping (ms)
+#ifndef CHSTATS_WINDOW_MS
+#define CHSTATS_WINDOW_MS 10000
+#endif
+#define CHSTATS_DWELL_MS 200
+
+// RSSI histogram: 10 dB bins from -100 dBm up
+#define CHSTATS_RSSI_BINS 8
+
+// Frame classes (802.11 frame control type field)
+enum FrameClass : uint8_t {
+    FRAME_MGMT,
+    FRAME_CTRL,
+    FRAME_DATA,
+    FRAME_EXT,
+    FRAME_CLASS_COUNT
+};
+
+// One channel over the last completed window
+struct ChannelSummary {
+    uint8_t channel;
+    uint32_t listenMs;                        // Time the sniffer sat on it
+    uint32_t frames;
+    uint32_t framesByClass[FRAME_CLASS_COUNT];
+    uint32_t beacons;
+    uint32_t probes;                          // Requests and responses
+    float framesPerSecond;                    // Per second of listen time
+    float airtimePercent;                     // Estimated busy share of listen time
+    uint16_t transmitters;                    // Distinct senders (estimated)
+    int8_t rssiMedian;                        // dBm, 0 if no frames
+    uint16_t rssiHistogram[CHSTATS_RSSI_BINS];
+};
+
+// Reset both windows
+void chstats_init();
+
+// Account one received frame. Safe to call from the sniffer callback.
+void IRAM_ATTR chstats_record(const wifi_pkt_rx_ctrl_t& ctrl, const uint8_t* payload);
+
+// Whether the sniffer is currently receiving (listen time only accrues
+// while it is); set by wifi_enable/disable_promiscuous()
+void chstats_setListening(bool listening);
+
+// Hop channels and roll the window. Returns true when a new window was
+// just completed. Call from loop().
+bool chstats_service();
+
+// Summary of one channel (1-13) for the last completed window
+bool chstats_getChannel(uint8_t channel, ChannelSummary& out);
+
+// One compact line per channel that had any traffic
+void chstats_printReport(Print& out);
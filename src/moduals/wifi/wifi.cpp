@@ -1,15 +1,22 @@
 #include "wifi_scanner.h"
 #include <WiFi.h>
 #include <esp_wifi.h>
-#include "../utils/distance.h"
+#include "../utils/rssi_kernels.h"
+#include "../utils/mac_key.h"
+#include "channel_stats.h"
 
 using namespace std;
 
 // Packet sniffing callback
 static void wifi_sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
+    wifi_promiscuous_pkt_t* pkt = (wifi_promiscuous_pkt_t*)buf;
+    
+    // Every frame feeds the channel analytics (O(1), no allocation)
+    chstats_record(pkt->rx_ctrl, pkt->payload);
+    
+#ifdef WIFI_SNIFFER_LOG
     if (type != WIFI_PKT_MGMT) return;
     
-    wifi_promiscuous_pkt_t* pkt = (wifi_promiscuous_pkt_t*)buf;
     wifi_pkt_rx_ctrl_t ctrl = pkt->rx_ctrl;
     
     // Get packet data
@@ -31,6 +38,7 @@ static void wifi_sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
                          macStr, ctrl.rssi, ctrl.channel);
         }
     }
+#endif
 }
 
 void wifi_init() {
@@ -45,11 +53,13 @@ void wifi_enable_promiscuous() {
     // Enable promiscuous mode for packet sniffing
     esp_wifi_set_promiscuous(true);
     esp_wifi_set_promiscuous_rx_cb(&wifi_sniffer_callback);
+    chstats_setListening(true);
     Serial.println("Promiscuous mode enabled - Packet sniffing active");
 }
 
 void wifi_disable_promiscuous() {
     esp_wifi_set_promiscuous(false);
+    chstats_setListening(false);
     Serial.println("Promiscuous mode disabled");
 }
 
@@ -57,7 +67,47 @@ void wifi_set_channel(uint8_t channel) {
     esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
 }
 
-std::vector<Device> wifi_scan() {
+// Shortest passive dwell that still catches a beacon (102.4 ms interval)
+const uint16_t PASSIVE_MIN_DWELL = 120;
+
+Device wifi_recordToDevice(const wifi_ap_record_t& record) {
+    char mac[18];
+    mac_format(mac_fromBytes(record.bssid), mac);
+    
+    Device d;
+    d.mac = mac;
+    d.name = (const char*)record.ssid;
+    d.rssi = record.rssi;
+    d.distance = rssi_distance(d.rssi);
+    d.type = TYPE_WIFI_AP;
+    d.channel = record.primary;
+    d.encryption = record.authmode;
+    d.vendor = VENDOR_UNKNOWN;
+    d.fingerprint = 0;
+    d.rotatingAddress = false;
+    d.addrType = 0;
+    return d;
+}
+
+#if !defined(ESP_ARDUINO_VERSION_MAJOR) || ESP_ARDUINO_VERSION_MAJOR < 3
+// Core 2.x keeps the record accessor protected. Reading the driver list
+// with esp_wifi_scan_get_ap_records() instead would race the core's own
+// scan-done handler, which drains that list into this buffer.
+struct ScanBuffer : WiFiScanClass {
+    static void* record(int i) { return _getScanInfoByIndex(i); }
+};
+#endif
+
+// Record i of the last scan, read in place from the core's scan buffer
+static const wifi_ap_record_t* scanRecord(int i) {
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+    return (const wifi_ap_record_t*)WiFi.getScanInfoByIndex(i);
+#else
+    return (const wifi_ap_record_t*)ScanBuffer::record(i);
+#endif
+}
+
+std::vector<Device> wifi_scan(uint32_t dwellMs) {
     // Disable promiscuous mode during scan
     bool wasPromiscuous = false;
     esp_wifi_get_promiscuous(&wasPromiscuous);
@@ -68,20 +118,16 @@ std::vector<Device> wifi_scan() {
     std::vector<Device> list;
 
     // Scan for networks (hidden networks included)
-    int n = WiFi.scanNetworks(false, true, false, 300);
+    int n = WiFi.scanNetworks(false, true, false, dwellMs);
+    list.reserve(n > 0 ? n : 0);
 
     for (int i = 0; i < n; i++) {
-        Device d;
-        d.mac = WiFi.BSSIDstr(i);
-        d.name = WiFi.SSID(i);
-        d.rssi = WiFi.RSSI(i);
-        d.distance = estimateDistance(d.rssi);
-        d.type = TYPE_WIFI_AP;
-        d.channel = WiFi.channel(i);
-        d.encryption = WiFi.encryptionType(i);
-
-        list.push_back(d);
+        const wifi_ap_record_t* record = scanRecord(i);
+        if (record != nullptr) {
+            list.push_back(wifi_recordToDevice(*record));
+        }
     }
+    WiFi.scanDelete();
     
     // Re-enable promiscuous mode if it was on
     if (wasPromiscuous) {
@@ -91,6 +137,49 @@ std::vector<Device> wifi_scan() {
     return list;
 }
 
+int wifi_scanChannels(const WiFiChannelScan* plan, int count, WiFiRecordHandler handler) {
+    bool wasPromiscuous = false;
+    esp_wifi_get_promiscuous(&wasPromiscuous);
+    if (wasPromiscuous) {
+        wifi_disable_promiscuous();
+    }
+    
+    int delivered = 0;
+    
+    for (int c = 0; c < count; c++) {
+        const WiFiChannelScan& ch = plan[c];
+        int n = WiFi.scanNetworks(false, true, ch.passive, ch.dwellMs, ch.channel);
+        
+        // Records stay in the scan buffer; nothing is copied into Strings here
+        for (int i = 0; i < n; i++) {
+            const wifi_ap_record_t* record = scanRecord(i);
+            if (record != nullptr) {
+                handler(*record);
+                delivered++;
+            }
+        }
+        WiFi.scanDelete();
+    }
+    
+    if (wasPromiscuous) {
+        wifi_enable_promiscuous();
+    }
+    
+    return delivered;
+}
+
+int wifi_defaultChannelPlan(WiFiChannelScan* plan, uint16_t dwellMs) {
+    for (int i = 0; i < WIFI_CHANNEL_COUNT; i++) {
+        uint8_t channel = i + 1;
+        bool passive = channel != 1 && channel != 6 && channel != 11;
+        
+        plan[i].channel = channel;
+        plan[i].passive = passive;
+        plan[i].dwellMs = passive && dwellMs < PASSIVE_MIN_DWELL ? PASSIVE_MIN_DWELL : dwellMs;
+    }
+    return WIFI_CHANNEL_COUNT;
+}
+
 bool wifi_isOpenNetwork(const Device& device) {
     return device.encryption == WIFI_AUTH_OPEN;
 }
@@ -2,6 +2,9 @@
 #include <vector>
 #include <Arduino.h>
 #include <WiFi.h>
+#include <esp_wifi.h>
+#include "../utils/vendor.h"
+#include "../utils/intern.h"
 
 using namespace std;
 
@@ -13,18 +16,48 @@ enum DeviceType {
 
 struct Device {
     String mac;
-    String name;
+    InternedName name;
     int rssi;
     float distance;
     DeviceType type;
     uint8_t channel;
     wifi_auth_mode_t encryption;
+    Vendor vendor;
+    uint32_t fingerprint;    // BLE advertisement fingerprint, 0 if none
+    bool rotatingAddress;    // BLE private address that may rotate
+    uint8_t addrType;        // BLE address type (esp_ble_addr_type_t), 0 for WiFi
 };
 
+// How to scan one channel
+struct WiFiChannelScan {
+    uint8_t channel;
+    bool passive;       // Listen for beacons only, no probe requests
+    uint16_t dwellMs;
+};
+
+#define WIFI_CHANNEL_COUNT 13
+
+// Called with each AP record as soon as its channel has been scanned
+typedef void (*WiFiRecordHandler)(const wifi_ap_record_t& record);
+
 void wifi_init();
-std::vector<Device> wifi_scan();
+// Active scan of all channels, dwelling dwellMs on each
+std::vector<Device> wifi_scan(uint32_t dwellMs = 300);
+
+// Scan channel by channel, handing each channel's raw records to `handler`
+// before moving on. Returns the number of records delivered.
+int wifi_scanChannels(const WiFiChannelScan* plan, int count, WiFiRecordHandler handler);
+
+// Fill `plan` (WIFI_CHANNEL_COUNT entries) with channels 1-13: active on
+// 1, 6 and 11 where most APs sit, passive on the rest. Passive dwell is
+// raised to cover at least one beacon interval. Returns the entry count.
+int wifi_defaultChannelPlan(WiFiChannelScan* plan, uint16_t dwellMs);
+
+// Convert a raw scan record (builds the String fields)
+Device wifi_recordToDevice(const wifi_ap_record_t& record);
 
-// Packet sniffing
+// Packet sniffing; frames feed the channel analytics (see channel_stats.h).
+// Build with -D WIFI_SNIFFER_LOG to also log management frames.
 void wifi_enable_promiscuous();
 void wifi_disable_promiscuous();
 void wifi_set_channel(uint8_t channel);
@@ -0,0 +1,341 @@
+// Host-side collector for multi-sensor deployments.
+//
+// Ingests the "@DR" record lines that every sensor node writes to its serial
+// port (see src/moduals/aggregation) and keeps one merged, site-wide device
+// table with the latest RSSI each sensor reported, for coarse localization.
+// Everything runs on one thread around poll(), so dozens of nodes and tens of
+// thousands of devices stay on a single core.
+//
+// Build:
+//   g++ -O2 -std=c++17 -I src/moduals/aggregation tools/collector/collector.cpp -o collector
+//
+// Usage:
+//   collector [-i seconds] [-o table.csv] source...
+//
+// A source is a serial device (/dev/ttyACM0), "unix:/path/to.sock" to accept
+// any number of local socket connections (the stand-in for nodes during
+// development), or "-" for stdin. Non-record lines (the node's regular logs)
+// are ignored.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "device_record.h"
+
+// Upper bound on sensor nodes tracked per device
+const int MAX_SENSORS = 64;
+
+// Per-sensor readings older than this no longer count for localization
+const uint32_t SENSOR_STALE_MS = 30000;
+
+// Longest line kept in a stream buffer before it is discarded as garbage
+const size_t MAX_LINE = 256;
+
+struct SiteDevice {
+    DeviceRecord rec;
+    int8_t rssi[MAX_SENSORS];        // Latest RSSI per sensor slot
+    uint32_t rssiAt[MAX_SENSORS];    // When that reading was taken (0 = never)
+};
+
+struct Source {
+    int fd;
+    bool listener;
+    std::string buf;
+};
+
+static std::vector<Source> sources;
+static std::vector<SiteDevice> devices;
+static std::unordered_map<uint64_t, uint32_t> deviceIndex;
+static std::unordered_map<uint32_t, int> sensorSlots;
+static std::vector<uint32_t> sensorIds;
+static uint64_t recordsIn = 0, recordsDropped = 0;
+static volatile sig_atomic_t running = 1;
+
+static uint32_t nowMs() {
+    static timespec start = {0, 0};
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    if (start.tv_sec == 0 && start.tv_nsec == 0) start = ts;
+    // Offset by a day so rebased ages never underflow right after startup
+    return 86400000u + (uint32_t)((ts.tv_sec - start.tv_sec) * 1000 +
+                                  (ts.tv_nsec - start.tv_nsec) / 1000000);
+}
+
+static int sensorSlot(uint32_t node) {
+    auto it = sensorSlots.find(node);
+    if (it != sensorSlots.end()) return it->second;
+    if ((int)sensorIds.size() >= MAX_SENSORS) return -1;
+
+    int slot = sensorIds.size();
+    sensorSlots[node] = slot;
+    sensorIds.push_back(node);
+    fprintf(stderr, "[SENSOR] %08X joined as slot %d\n", node, slot);
+    return slot;
+}
+
+static void ingestRecord(uint32_t node, const DeviceRecord& rec) {
+    int slot = sensorSlot(node);
+    if (slot < 0) {
+        recordsDropped++;
+        return;
+    }
+    recordsIn++;
+
+    auto it = deviceIndex.find(rec.mac);
+    SiteDevice* dev;
+    if (it == deviceIndex.end()) {
+        deviceIndex.emplace(rec.mac, (uint32_t)devices.size());
+        devices.emplace_back();
+        dev = &devices.back();
+        dev->rec = rec;
+        memset(dev->rssiAt, 0, sizeof(dev->rssiAt));
+    } else {
+        dev = &devices[it->second];
+        record_merge(dev->rec, rec);
+    }
+
+    // Per-sensor RSSI is last-writer-wins as well
+    if (rec.lastSeen >= dev->rssiAt[slot]) {
+        dev->rssi[slot] = rec.rssi;
+        dev->rssiAt[slot] = rec.lastSeen;
+    }
+}
+
+static void ingestLine(const char* line) {
+    const char* tag = strstr(line, RECORD_TAG ",");
+    if (tag == nullptr) return;
+
+    uint32_t node;
+    DeviceRecord rec;
+    if (record_parse(tag, nowMs(), &node, &rec)) {
+        ingestRecord(node, rec);
+    } else {
+        recordsDropped++;
+    }
+}
+
+static void ingestBytes(Source& src, const char* data, size_t len) {
+    src.buf.append(data, len);
+
+    size_t start = 0;
+    for (;;) {
+        size_t nl = src.buf.find('\n', start);
+        if (nl == std::string::npos) break;
+        src.buf[nl] = '\0';
+        ingestLine(src.buf.c_str() + start);
+        start = nl + 1;
+    }
+    src.buf.erase(0, start);
+
+    if (src.buf.size() > MAX_LINE) src.buf.clear();
+}
+
+static bool openSerial(const char* path) {
+    int fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B115200);
+        cfsetospeed(&tio, B115200);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    sources.push_back({fd, false, std::string()});
+    return true;
+}
+
+static bool openListener(const char* path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+        fprintf(stderr, "Cannot listen on %s: %s\n", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    sources.push_back({fd, true, std::string()});
+    return true;
+}
+
+// Sensor slot with the strongest fresh reading, -1 if none
+static int nearestSensor(const SiteDevice& dev, uint32_t now) {
+    int best = -1;
+    for (int s = 0; s < (int)sensorIds.size(); s++) {
+        if (dev.rssiAt[s] == 0 || now - dev.rssiAt[s] > SENSOR_STALE_MS) continue;
+        if (best < 0 || dev.rssi[s] > dev.rssi[best]) best = s;
+    }
+    return best;
+}
+
+// Quoted CSV field: embedded quotes doubled, line breaks dropped
+static void writeQuoted(FILE* f, const char* text) {
+    fputc('"', f);
+    for (const char* p = text; *p != '\0'; p++) {
+        if (*p == '\r' || *p == '\n') continue;
+        if (*p == '"') fputc('"', f);
+        fputc(*p, f);
+    }
+    fputc('"', f);
+}
+
+static void writeTable(const char* path) {
+    std::string tmp = std::string(path) + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (f == nullptr) return;
+
+    uint32_t now = nowMs();
+    fprintf(f, "mac,type,channel,seen_count,last_age_ms,nearest");
+    for (uint32_t id : sensorIds) fprintf(f, ",rssi_%08X", id);
+    fprintf(f, ",name\n");
+
+    for (const auto& dev : devices) {
+        char mac[18];
+        mac_format(dev.rec.mac, mac);
+        int nearest = nearestSensor(dev, now);
+
+        fprintf(f, "%s,%u,%u,%u,%u,", mac, dev.rec.type, dev.rec.channel,
+                dev.rec.seenCount, now - dev.rec.lastSeen);
+        if (nearest >= 0) fprintf(f, "%08X", sensorIds[nearest]);
+
+        for (int s = 0; s < (int)sensorIds.size(); s++) {
+            if (dev.rssiAt[s] != 0 && now - dev.rssiAt[s] <= SENSOR_STALE_MS) {
+                fprintf(f, ",%d", dev.rssi[s]);
+            } else {
+                fprintf(f, ",");
+            }
+        }
+        fputc(',', f);
+        writeQuoted(f, dev.rec.name);
+        fputc('\n', f);
+    }
+
+    fclose(f);
+    rename(tmp.c_str(), path);
+}
+
+static void printStats() {
+    uint32_t now = nowMs();
+    size_t active = 0;
+    for (const auto& dev : devices) {
+        if (now - dev.rec.lastSeen <= SENSOR_STALE_MS) active++;
+    }
+    fprintf(stderr, "[STATS] sensors=%zu devices=%zu active=%zu records=%llu dropped=%llu\n",
+            sensorIds.size(), devices.size(), active,
+            (unsigned long long)recordsIn, (unsigned long long)recordsDropped);
+}
+
+static void onSignal(int) {
+    running = 0;
+}
+
+int main(int argc, char** argv) {
+    int interval = 5;
+    const char* outPath = nullptr;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:o:")) != -1) {
+        if (opt == 'i') interval = atoi(optarg);
+        else if (opt == 'o') outPath = optarg;
+        else {
+            fprintf(stderr, "usage: %s [-i seconds] [-o table.csv] source...\n", argv[0]);
+            return 2;
+        }
+    }
+
+    for (int i = optind; i < argc; i++) {
+        if (strcmp(argv[i], "-") == 0) {
+            sources.push_back({STDIN_FILENO, false, std::string()});
+        } else if (strncmp(argv[i], "unix:", 5) == 0) {
+            if (!openListener(argv[i] + 5)) return 1;
+        } else if (!openSerial(argv[i])) {
+            return 1;
+        }
+    }
+    if (sources.empty()) {
+        fprintf(stderr, "No sources given\n");
+        return 2;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+    deviceIndex.reserve(1 << 15);
+    devices.reserve(1 << 15);
+
+    std::vector<pollfd> fds;
+    char chunk[4096];
+    uint32_t lastReport = nowMs();
+
+    while (running) {
+        fds.resize(sources.size());
+        for (size_t i = 0; i < sources.size(); i++) {
+            fds[i].fd = sources[i].fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        int ready = poll(fds.data(), fds.size(), 200);
+        if (ready < 0 && errno != EINTR) break;
+
+        // Iterate backwards so closed sources can be erased in place
+        for (size_t i = fds.size(); i-- > 0;) {
+            if (fds[i].revents == 0) continue;
+            Source& src = sources[i];
+
+            if (src.listener) {
+                int client = accept(src.fd, nullptr, nullptr);
+                if (client >= 0) {
+                    fcntl(client, F_SETFL, O_NONBLOCK);
+                    sources.push_back({client, false, std::string()});
+                }
+                continue;
+            }
+
+            ssize_t n = read(src.fd, chunk, sizeof(chunk));
+            if (n > 0) {
+                ingestBytes(src, chunk, n);
+            } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                close(src.fd);
+                sources.erase(sources.begin() + i);
+            }
+        }
+
+        if (sources.empty()) break;
+
+        uint32_t now = nowMs();
+        if (now - lastReport >= (uint32_t)interval * 1000) {
+            lastReport = now;
+            printStats();
+            if (outPath != nullptr) writeTable(outPath);
+        }
+    }
+
+    printStats();
+    if (outPath != nullptr) writeTable(outPath);
+    return 0;
+}
@@ -0,0 +1,128 @@
+// Host-side accuracy and throughput benchmark for the presence sketch.
+//
+// Runs the same Bloom filter and HyperLogLog code as the board
+// (src/moduals/sketch/sketch_core.h) at a range of devices per hour and
+// reports:
+//   - Bloom false-positive rate with one hour's generation filled, and with
+//     all SKETCH_BLOOM_HOURS generations filled by different devices
+//   - HyperLogLog relative error, mean and worst over several device sets
+//   - nanoseconds per recorded sighting and per "seen recently?" query
+//
+// Build:
+//   g++ -O2 -std=c++17 -I src/moduals/sketch tools/sketch_bench/sketch_bench.cpp -o sketch_bench
+//
+// Usage:
+//   sketch_bench [devices-per-hour...]      (default: 100 1000 3000)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "sketch_core.h"
+
+// Unseen keys tested per false-positive measurement
+const int PROBES = 100000;
+
+// Device sets averaged for the HyperLogLog error
+const int HLL_TRIALS = 16;
+
+struct Window {
+    uint8_t bloom[SKETCH_BLOOM_HOURS][BLOOM_BYTES];
+    uint8_t hll[HLL_REGISTERS];
+};
+
+// Devices from one vendor block, as a real site mostly sees
+static uint64_t deviceKey(uint32_t oui, uint32_t i) {
+    return ((uint64_t)oui << 24) + i;
+}
+
+// What sketch_record() does for one sighting
+static void record(Window& w, int gen, uint64_t key) {
+    SketchHash h = sketch_hash(key);
+    bloom_set(w.bloom[gen], h);
+    hll_add(w.hll, h.h1);
+}
+
+// What sketch_seenRecently() does
+static bool seenRecently(const Window& w, uint64_t key) {
+    SketchHash h = sketch_hash(key);
+    for (int gen = 0; gen < SKETCH_BLOOM_HOURS; gen++) {
+        if (bloom_test(w.bloom[gen], h)) return true;
+    }
+    return false;
+}
+
+// Probe keys past every inserted one, so every hit is a false positive
+static double falsePositiveRate(const Window& w, uint32_t oui, uint32_t firstUnseen) {
+    int hits = 0;
+    for (int p = 0; p < PROBES; p++) {
+        if (seenRecently(w, deviceKey(oui, firstUnseen + p))) hits++;
+    }
+    return (double)hits / PROBES;
+}
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void run(int count) {
+    const uint32_t oui = 0xA4C138;
+    static Window w;
+    memset(&w, 0, sizeof(w));
+
+    // One generation holding this hour's devices
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        record(w, 0, deviceKey(oui, i));
+    }
+    double recordNs = elapsedNs(start) / count;
+
+    uint32_t firstUnseen = count * SKETCH_BLOOM_HOURS;
+    double hourFp = falsePositiveRate(w, oui, firstUnseen);
+
+    // Different devices every hour, across the whole window
+    for (int gen = 1; gen < SKETCH_BLOOM_HOURS; gen++) {
+        for (int i = 0; i < count; i++) {
+            record(w, gen, deviceKey(oui, gen * count + i));
+        }
+    }
+
+    start = std::chrono::steady_clock::now();
+    double windowFp = falsePositiveRate(w, oui, firstUnseen);
+    double queryNs = elapsedNs(start) / PROBES;
+
+    // HyperLogLog error over independent device sets
+    double sumError = 0, worstError = 0;
+    for (int t = 0; t < HLL_TRIALS; t++) {
+        uint8_t hll[HLL_REGISTERS] = {};
+        for (int i = 0; i < count; i++) {
+            hll_add(hll, sketch_hash(deviceKey(oui + t, i)).h1);
+        }
+        double error = ((double)hll_estimate(hll) - count) / count;
+        sumError += fabs(error);
+        if (fabs(error) > fabs(worstError)) worstError = error;
+    }
+
+    printf("%6d/h  bloom FP %6.2f%%  window FP %6.2f%%  HLL error %5.2f%% (worst %+6.2f%%)"
+           "  record %5.1f ns  query %5.1f ns\n",
+           count, hourFp * 100, windowFp * 100, sumError / HLL_TRIALS * 100,
+           worstError * 100, recordNs, queryNs);
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> counts;
+    for (int i = 1; i < argc; i++) {
+        int count = atoi(argv[i]);
+        if (count <= 0) {
+            fprintf(stderr, "usage: %s [devices-per-hour...]\n", argv[0]);
+            return 1;
+        }
+        counts.push_back(count);
+    }
+    if (counts.empty()) counts = {100, 1000, 3000};
+
+    printf("Bloom: %d generations x %d bits, %d hashes; HLL: %d registers\n",
+           SKETCH_BLOOM_HOURS, SKETCH_BLOOM_BITS, BLOOM_HASHES, HLL_REGISTERS);
+    for (int count : counts) run(count);
+    return 0;
+}
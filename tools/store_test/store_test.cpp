@@ -0,0 +1,253 @@
+// Host-side test of the persistent device store's file format.
+//
+// Exercises the portable core (src/moduals/storage/device_store.cpp)
+// against a temporary directory:
+//   - replay of a checkpoint plus later log batches
+//   - tombstones removing devices written in earlier batches
+//   - a torn tail batch, skipped on load and flagged for compaction
+//   - compaction with batches appended while it is in progress, and a
+//     compaction interrupted before it could finish
+// and reports how long a restore of a full log takes.
+//
+// Build and run:
+//   g++ -O2 -std=c++17 -I src/moduals/storage tools/store_test/store_test.cpp
+//       src/moduals/storage/device_store.cpp -o store_test
+//   ./store_test
+//
+// Exits non-zero if any check fails.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "device_store.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "  FAILED line %d: %s\n", __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static StoredDevice makeDevice(uint64_t key, uint32_t seenCount) {
+    StoredDevice rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.key = key;
+    rec.addrKey = key;
+    rec.seenCount = seenCount;
+    rec.rssi = -60;
+    rec.avgRSSI = -60;
+    rec.addressCount = 1;
+    snprintf(rec.name, sizeof(rec.name), "dev-%llx", (unsigned long long)key);
+    return rec;
+}
+
+static StoredDevice makeRemoval(uint64_t key) {
+    StoredDevice rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.key = key;
+    rec.flags = STORE_FLAG_REMOVED;
+    return rec;
+}
+
+// Fresh store in its own temp directory
+static std::string openStore(const char* name) {
+    char dir[] = "/tmp/store_test.XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    printf("%s (%s)\n", name, dir);
+    if (!store_init(dir)) {
+        fprintf(stderr, "  store_init failed\n");
+        exit(1);
+    }
+    return dir;
+}
+
+// Reopen as after a reboot and replay everything on disk
+static std::vector<StoredDevice> reload(const std::string& dir, uint64_t* clockMs = nullptr) {
+    std::vector<StoredDevice> out(1024);
+    uint64_t clock = 0;
+    store_init(dir.c_str());
+    int count = store_load(out.data(), out.size(), &clock);
+    out.resize(count);
+    if (clockMs != nullptr) *clockMs = clock;
+    return out;
+}
+
+static const StoredDevice* find(const std::vector<StoredDevice>& devices, uint64_t key) {
+    for (const auto& dev : devices) {
+        if (dev.key == key) return &dev;
+    }
+    return nullptr;
+}
+
+static void testReplay() {
+    std::string dir = openStore("replay");
+
+    StoredDevice first[] = { makeDevice(1, 1), makeDevice(2, 1) };
+    CHECK(store_appendBatch(first, 2, 1000));
+
+    // A later batch overrides an earlier one
+    StoredDevice second[] = { makeDevice(2, 5), makeDevice(3, 1) };
+    second[0].lastAge = 100;
+    CHECK(store_appendBatch(second, 2, 2000));
+
+    uint64_t clock = 0;
+    auto devices = reload(dir, &clock);
+    CHECK(devices.size() == 3);
+    CHECK(clock == 2000);
+    CHECK(find(devices, 2) != nullptr && find(devices, 2)->seenCount == 5);
+    CHECK(find(devices, 2) != nullptr && find(devices, 2)->lastAge == 100);
+
+    // Ages are rebased onto the newest clock on disk
+    CHECK(find(devices, 1) != nullptr && find(devices, 1)->lastAge == 1000);
+    CHECK(!store_needsCompaction());
+}
+
+static void testTombstones() {
+    std::string dir = openStore("tombstones");
+
+    StoredDevice added[] = { makeDevice(10, 1), makeDevice(11, 1), makeDevice(12, 1) };
+    CHECK(store_appendBatch(added, 3, 1000));
+
+    StoredDevice removed[] = { makeRemoval(11) };
+    CHECK(store_appendBatch(removed, 1, 2000));
+
+    auto devices = reload(dir);
+    CHECK(devices.size() == 2);
+    CHECK(find(devices, 11) == nullptr);
+
+    // A device seen again after its removal comes back
+    StoredDevice back[] = { makeDevice(11, 2) };
+    CHECK(store_appendBatch(back, 1, 3000));
+    devices = reload(dir);
+    CHECK(devices.size() == 3);
+    CHECK(find(devices, 11) != nullptr && find(devices, 11)->seenCount == 2);
+}
+
+static void testTornTail() {
+    std::string dir = openStore("torn tail");
+
+    StoredDevice good[] = { makeDevice(20, 1), makeDevice(21, 1) };
+    CHECK(store_appendBatch(good, 2, 1000));
+    long goodSize = store_logSize();
+
+    StoredDevice lost[] = { makeDevice(22, 1), makeRemoval(20) };
+    CHECK(store_appendBatch(lost, 2, 2000));
+
+    // Cut the last batch in half, as a power loss mid-write would
+    std::string log = dir + "/log.bin";
+    long fullSize = store_logSize();
+    CHECK(truncate(log.c_str(), goodSize + (fullSize - goodSize) / 2) == 0);
+
+    uint64_t clock = 0;
+    auto devices = reload(dir, &clock);
+    CHECK(devices.size() == 2);
+    CHECK(find(devices, 20) != nullptr);
+    CHECK(find(devices, 22) == nullptr);
+    CHECK(clock == 1000);
+    CHECK(store_needsCompaction());
+
+    // Compacting rewrites the files without the damaged tail
+    CHECK(store_beginCompaction(clock));
+    CHECK(store_compactWrite(devices.data(), devices.size()));
+    CHECK(store_finishCompaction());
+
+    StoredDevice after[] = { makeDevice(23, 1) };
+    CHECK(store_appendBatch(after, 1, 3000));
+    devices = reload(dir);
+    CHECK(devices.size() == 3);
+    CHECK(find(devices, 23) != nullptr);
+    CHECK(!store_needsCompaction());
+}
+
+static void testCompaction() {
+    std::string dir = openStore("compaction");
+
+    StoredDevice before[] = { makeDevice(30, 1), makeDevice(31, 1), makeDevice(32, 1) };
+    CHECK(store_appendBatch(before, 3, 1000));
+
+    // Snapshot of the table as the tracker holds it when compaction starts
+    std::vector<StoredDevice> snapshot(before, before + 3);
+    CHECK(store_beginCompaction(1000));
+    CHECK(store_compacting());
+
+    // Batches written while the checkpoint is streamed out go to the new log
+    CHECK(store_compactWrite(&snapshot[0], 2));
+    StoredDevice during[] = { makeDevice(31, 7), makeRemoval(32), makeDevice(33, 1) };
+    CHECK(store_appendBatch(during, 3, 2000));
+    CHECK(store_compactWrite(&snapshot[2], 1));
+
+    // Interrupted here: the old log still covers what the checkpoint lacks
+    auto devices = reload(dir);
+    CHECK(devices.size() == 3);
+    CHECK(find(devices, 31) != nullptr && find(devices, 31)->seenCount == 7);
+    CHECK(find(devices, 32) == nullptr);
+    CHECK(find(devices, 33) != nullptr);
+    CHECK(!store_compacting());
+
+    // Compact again after the "reboot" and let it finish
+    CHECK(store_beginCompaction(2000));
+    CHECK(store_compactWrite(devices.data(), devices.size()));
+    StoredDevice late[] = { makeDevice(34, 1) };
+    CHECK(store_appendBatch(late, 1, 3000));
+    CHECK(store_finishCompaction());
+
+    std::string old = dir + "/log.old";
+    CHECK(access(old.c_str(), F_OK) != 0);
+
+    devices = reload(dir);
+    CHECK(devices.size() == 4);
+    CHECK(find(devices, 31) != nullptr && find(devices, 31)->seenCount == 7);
+    CHECK(find(devices, 32) == nullptr);
+    CHECK(find(devices, 34) != nullptr);
+    CHECK(!store_needsCompaction());
+}
+
+// Worst case restore: a full-size checkpoint plus a log at STORE_LOG_MAX
+static void timeRestore() {
+    std::string dir = openStore("restore time");
+
+    std::vector<StoredDevice> table;
+    for (int i = 0; i < 1024; i++) table.push_back(makeDevice(100 + i, 1));
+    CHECK(store_beginCompaction(1000));
+    CHECK(store_compactWrite(table.data(), table.size()));
+    CHECK(store_finishCompaction());
+
+    uint64_t clock = 1000;
+    int batches = 0;
+    while (store_logSize() < STORE_LOG_MAX) {
+        clock += STORE_FLUSH_INTERVAL;
+        CHECK(store_appendBatch(&table[(batches * 16) % 1000], 16, clock));
+        batches++;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto devices = reload(dir);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    CHECK(devices.size() == 1024);
+    printf("  1024-device checkpoint + %d batches (%ld bytes of log): %.2f ms\n",
+           batches, store_logSize(), ms);
+}
+
+int main() {
+    testReplay();
+    testTombstones();
+    testTornTail();
+    testCompaction();
+    timeRestore();
+
+    if (failures > 0) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All store tests passed\n");
+    return 0;
+}